@@ -1,18 +1,24 @@
-rm fp_osd
+rm fp_osd fp_osd_ctl fp_osd_shm
+
+#control socket client, used by osd.sh/tinyosd.sh
+gcc -o fp_osd_ctl fp_osd_ctl.c
+
+#shared memory metrics writer, for scripts and test purpose
+gcc -o fp_osd_shm fp_osd_shm.c
 
 #wiringPi
-#gcc -DUSE_WIRINGPI -o fp_osd fp_osd.c -l:libpng.a -l:libz.a -l:libm.a -lbcm_host -L/opt/vc/lib/ -I/opt/vc/include/ -lwiringPi
+#gcc -DUSE_WIRINGPI -pthread -o fp_osd fp_osd.c -l:libpng.a -l:libz.a -l:libm.a -lbcm_host -L/opt/vc/lib/ -I/opt/vc/include/ -lwiringPi
 
 #gpiod
-#gcc -DUSE_GPIOD -o fp_osd fp_osd.c -l:libpng.a -l:libz.a -l:libm.a -lbcm_host -L/opt/vc/lib/ -I/opt/vc/include/ -l:libgpiod.a
+#gcc -DUSE_GPIOD -pthread -o fp_osd fp_osd.c -l:libpng.a -l:libz.a -l:libm.a -lbcm_host -L/opt/vc/lib/ -I/opt/vc/include/ -l:libgpiod.a
 
 #no gpio
-#gcc -o fp_osd fp_osd.c -l:libpng.a -l:libz.a -l:libm.a -lbcm_host -L/opt/vc/lib/ -I/opt/vc/include/
+#gcc -pthread -o fp_osd fp_osd.c -l:libpng.a -l:libz.a -l:libm.a -lbcm_host -L/opt/vc/lib/ -I/opt/vc/include/
 
 #sudo ./fp_osd
 
 #Freeplay Zero 2 specific
-gcc -DUSE_WIRINGPI -DNO_SIGNAL_FILE -DNO_SIGNAL -o fp_osd fp_osd.c -l:libpng.a -l:libz.a -l:libm.a -lbcm_host -L/opt/vc/lib/ -I/opt/vc/include/ -lwiringPi
+gcc -DUSE_WIRINGPI -DNO_SIGNAL_FILE -DNO_SIGNAL -pthread -o fp_osd fp_osd.c -l:libpng.a -l:libz.a -l:libm.a -lbcm_host -L/opt/vc/lib/ -I/opt/vc/include/ -lwiringPi
 sudo ./fp_osd -evdev_device "Freeplay Gamepad 0" -evdev_osd_sequence 0x13c,0x138 -evdev_tinyosd_sequence 0x13c,0x139 -osd_gpio -1 -tinyosd_gpio -1 -lowbat_gpio 10
 
 #test all functions based on ./test folder files
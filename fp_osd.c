@@ -43,6 +43,31 @@ static double get_time_double(void){ //get time in double (seconds), takes aroun
     #define print_stdout(fmt, ...) do {fprintf(stdout, "%lf: %s:%d: %s(): " fmt, get_time_double() - program_start_time , __FILE__, __LINE__, __func__, ##__VA_ARGS__);} while (0) //Flavor: print advanced debug to stderr
 #endif
 
+//external commands
+#if !defined(NO_GPIO) || !(defined(NO_OSD) && defined(NO_TINYOSD))
+static FILE* command_popen(const char* command, pid_t* pid){ //popen() equivalent, child gets an empty signal mask instead of signals blocked for signalfd, return NULL on failure
+    int pipe_fd[2]; if (pipe(pipe_fd) != 0){return NULL;}
+    fcntl(pipe_fd[0], F_SETFD, FD_CLOEXEC); fcntl(pipe_fd[1], F_SETFD, FD_CLOEXEC); //not inherited by other children
+    posix_spawn_file_actions_t actions; posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipe_fd[1], STDOUT_FILENO); //dup2 clears close-on-exec
+    posix_spawnattr_t attr; posix_spawnattr_init(&attr);
+    sigset_t child_mask; sigemptyset(&child_mask); //SIGTERM and SIGINT stop child again
+    posix_spawnattr_setsigmask(&attr, &child_mask); posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+    char *argv[] = {"sh", "-c", (char*)command, NULL};
+    int ret = posix_spawn(pid, "/bin/sh", &actions, &attr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions); posix_spawnattr_destroy(&attr); close(pipe_fd[1]);
+    if (ret != 0){close(pipe_fd[0]); return NULL;}
+    FILE *filehandle = fdopen(pipe_fd[0], "r");
+    if (filehandle == NULL){close(pipe_fd[0]); waitpid(*pid, NULL, 0);}
+    return filehandle;
+}
+
+static void command_pclose(FILE* filehandle, pid_t pid){ //pclose() equivalent for command_popen()
+    fclose(filehandle);
+    while (waitpid(pid, NULL, 0) < 0 && errno == EINTR);
+}
+#endif
+
 
 //debug
 #ifdef CHARSET_EXPORT
@@ -303,6 +328,18 @@ static DISPMANX_RESOURCE_HANDLE_T dispmanx_resource_create_from_png(char* filena
     return resource;
 }
 
+static DISPMANX_UPDATE_HANDLE_T dispmanx_update_get(DISPMANX_UPDATE_HANDLE_T* update){ //start vc update on first element change of current loop, return update handle
+    if (*update == 0){
+        *update = vc_dispmanx_update_start(0);
+        if (debug && *update == 0){print_stderr("vc_dispmanx_update_start() failed.\n");}
+    }
+    return *update;
+}
+
+static void dispmanx_update_callback(DISPMANX_UPDATE_HANDLE_T update, void* arg){ //async update completion, called from videocore thread, wake main loop
+    uint64_t value = 1; if (write(dispmanx_event_fd, &value, sizeof(value)) < 0){} //nothing more can be done from here
+}
+
 
 //gpio functions
 #ifndef NO_GPIO
@@ -331,6 +368,7 @@ static void gpio_init(void){ //init gpio things
                 } else if ((gpiod_fd[i] = gpiod_line_event_get_fd(gpiod_input_line[i])) < 0){print_stderr("gpiod_line_event_get_fd failed. errno:%d, consumer:'%s'.\n", -gpiod_fd[i], gpiod_consumer_name[i]); gpio_lib_failed = true;
                 } else {
                     fcntl(gpiod_fd[i], F_SETFL, fcntl(gpiod_fd[i], F_GETFL, 0) | O_NONBLOCK); //set gpiod fd to non blocking
+                    loop_fd_add(gpiod_fd[i], LOOP_SRC_GPIO, i); //wake main loop on edge event
                     print_stderr("Using libGPIOd to poll GPIO%d, chip:%s(%s), consumer:'%s'.\n", *gpio_pin[i], gpiod_chip_name(gpiod_chip), gpiod_chip_label(gpiod_chip), gpiod_consumer_name[i]);
                 }
             #endif
@@ -340,16 +378,27 @@ static void gpio_init(void){ //init gpio things
     if (gpio_lib_failed){
         #ifdef USE_GPIOD
             for (int i=0; i<gpio_pins_count; i++){
+                if (gpiod_fd[i] >= 0){loop_fd_remove(gpiod_fd[i]);}
                 if (gpiod_input_line[i] != NULL){gpiod_line_release(gpiod_input_line[i]);} gpiod_fd[i] = -1;
             }
         #endif
-        if (access("/usr/bin/raspi-gpio", F_OK) == 0){print_stderr("Falling back to '/usr/bin/raspi-gpio' program.\n"); gpio_external = true;}
-        for (int i=0; i<gpio_pins_count; i++){
-            if (gpio_external){
-                if (gpio_enabled[i]){print_stderr("gpio%d\n", *gpio_pin[i]);}
-            } else {gpio_enabled[i] = false;}
+        if (!gpio_cdev_init()){ //native gpio character device
+            if (access("/usr/bin/raspi-gpio", F_OK) == 0){print_stderr("Falling back to '/usr/bin/raspi-gpio' program.\n"); gpio_external = true;}
+            for (int i=0; i<gpio_pins_count; i++){
+                if (gpio_external){
+                    if (gpio_enabled[i]){print_stderr("gpio%d\n", *gpio_pin[i]);}
+                } else {gpio_enabled[i] = false;}
+            }
         }
     }
+
+    for (int i=0; i<gpio_pins_count; i++){ //edge events availability, initial state
+        gpio_edge_events[i] = gpio_enabled[i] && !gpio_external && gpio_cdev_fd >= 0;
+        #ifdef USE_GPIOD
+            if (gpio_enabled[i] && !gpio_external && gpiod_fd[i] >= 0){gpio_edge_events[i] = true;}
+        #endif
+        if (gpio_edge_events[i] && gpio_cdev_fd < 0){gpio_active[i] = gpio_check(i);} //gpio character device initial state set by gpio_cdev_init()
+    }
 }
 
 static bool gpio_check(int index){ //check if gpio pin state
@@ -361,7 +410,7 @@ static bool gpio_check(int index){ //check if gpio pin state
             ret = digitalRead(*gpio_pin[index]) > 0;
             if (*gpio_reversed[index]){ret = !ret;} //reverse input
         #elif defined(USE_GPIOD) //gpiod library
-            if (gpiod_fd >= 0 && gpiod_line_is_free(gpiod_input_line[index])){
+            if (gpiod_fd[index] >= 0){ //value readable from event requested line
                 int gpiod_ret = gpiod_line_get_value(gpiod_input_line[index]);
                 if (gpiod_ret >= 0){if (*gpio_reversed[index]){ret = !gpiod_ret;} else {ret = gpiod_ret;}} //reverse/normal input
             }
@@ -369,8 +418,8 @@ static bool gpio_check(int index){ //check if gpio pin state
     } else {
         int tmp_gpio = -1, tmp_level = -1;
         char buffer[32]; sprintf(buffer, "raspi-gpio get %d", *gpio_pin[index]);
-        FILE *filehandle = popen(buffer, "r");
-        if(filehandle != NULL){fscanf(filehandle, "%*[^0123456789]%d%*[^0123456789]%d", &tmp_gpio, &tmp_level); pclose(filehandle);} //GPIO %d: level=%d fsel=1 func=INPUT
+        pid_t command_pid; FILE *filehandle = command_popen(buffer, &command_pid);
+        if(filehandle != NULL){fscanf(filehandle, "%*[^0123456789]%d%*[^0123456789]%d", &tmp_gpio, &tmp_level); command_pclose(filehandle, command_pid);} //GPIO %d: level=%d fsel=1 func=INPUT
         if (tmp_gpio == *gpio_pin[index] && tmp_level >= 0){
             ret = tmp_level > 0;
             if (*gpio_reversed[index]){ret = !ret;} //reverse input
@@ -378,27 +427,284 @@ static bool gpio_check(int index){ //check if gpio pin state
     }
     return ret;
 }
+
+static bool gpio_cdev_init(void){ //request all enabled pins from gpio character device as one line request with both edges events and kernel debounce, return false on failure
+    struct gpio_v2_line_request request = {0};
+    for (int i=0; i<gpio_pins_count; i++){
+        if (!gpio_enabled[i]){continue;}
+        int line = -1;
+        for (int j=0; j<(int)request.num_lines; j++){if (request.offsets[j] == (uint32_t)*gpio_pin[i]){line = j; break;}} //pin already requested
+        if (line < 0){line = request.num_lines++; request.offsets[line] = *gpio_pin[i];}
+        gpio_cdev_line[i] = line;
+    }
+    if (request.num_lines == 0){return false;}
+
+    int chip_fd = open(gpio_chip_path, O_RDONLY | O_CLOEXEC);
+    if (chip_fd < 0){print_stderr("Failed to open '%s', errno:%d.\n", gpio_chip_path, errno); return false;}
+    strncpy(request.consumer, program_name, GPIO_MAX_NAME_SIZE-1);
+    request.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    if (gpio_debounce_ms > 0){
+        request.config.num_attrs = 1;
+        request.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_DEBOUNCE;
+        request.config.attrs[0].attr.debounce_period_us = gpio_debounce_ms * 1000;
+        request.config.attrs[0].mask = (1ULL << request.num_lines) - 1; //all lines
+    }
+    int ret = ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &request);
+    close(chip_fd); //line request fd stays valid
+    if (ret < 0){print_stderr("GPIO_V2_GET_LINE_IOCTL failed on '%s', errno:%d.\n", gpio_chip_path, errno); return false;}
+    gpio_cdev_fd = request.fd;
+
+    struct gpio_v2_line_values values = {.mask = (1ULL << request.num_lines) - 1}; //initial state, edge events only report changes
+    if (ioctl(gpio_cdev_fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0){print_stderr("GPIO_V2_LINE_GET_VALUES_IOCTL failed, errno:%d.\n", errno);}
+    for (int i=0; i<gpio_pins_count; i++){
+        if (gpio_cdev_line[i] >= 0){gpio_active[i] = ((values.bits >> gpio_cdev_line[i]) & 1) != *gpio_reversed[i];}
+    }
+
+    fcntl(gpio_cdev_fd, F_SETFL, fcntl(gpio_cdev_fd, F_GETFL, 0) | O_NONBLOCK);
+    loop_fd_add(gpio_cdev_fd, LOOP_SRC_GPIO, gpio_pins_count); //wake main loop on edge event, index past gpiod fds
+    for (int i=0; i<gpio_pins_count; i++){
+        if (gpio_enabled[i]){print_stderr("Using '%s' to watch GPIO%d edges, debounce:%dms.\n", gpio_chip_path, *gpio_pin[i], gpio_debounce_ms);}
+    }
+    return true;
+}
+
+static void gpio_cdev_process(void){ //drain gpio character device edge events, update pins state
+    struct gpio_v2_line_event events[16];
+    ssize_t len;
+    while ((len = read(gpio_cdev_fd, events, sizeof(events))) >= (ssize_t)sizeof(struct gpio_v2_line_event)){
+        for (int i=0; i<(int)(len / sizeof(struct gpio_v2_line_event)); i++){
+            for (int j=0; j<gpio_pins_count; j++){ //same pin can be used by multiple triggers
+                if (gpio_cdev_line[j] >= 0 && (uint32_t)*gpio_pin[j] == events[i].offset){gpio_edge(j, events[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE, (double)events[i].timestamp_ns / 1e9);} //monotonic timestamp by default
+            }
+        }
+    }
+}
+
+static void gpio_edge(int index, bool level, double time){ //raw level change from edge event or polling, time in monotonic sec, accepted by gpio_update() once stable for debounce period
+    bool active = level != *gpio_reversed[index];
+    double now = get_time_double();
+    if (time <= 0. || time > now || now - time > 1.){time = now;} //realtime or missing timestamp (libgpiod on kernel older than 5.7)
+    gpio_pending[index] = active; gpio_pending_time[index] = time; //restart stability window on each edge
+}
+
+static uint8_t gpio_update(double now){ //accept debounced pins state, return bitmask of pins pressed since last call
+    double debounce = (gpio_cdev_fd >= 0) ? 0. : gpio_debounce_ms / 1000.; //kernel debounce already applied on gpio character device
+    uint8_t pressed = 0;
+    for (int i=0; i<gpio_pins_count; i++){
+        if (gpio_pending_time[i] < 0. || now - gpio_pending_time[i] < debounce){continue;} //nothing pending or still bouncing
+        if (gpio_pending[i] != gpio_active[i]){
+            gpio_active[i] = gpio_pending[i];
+            if (gpio_active[i]){gpio_press_time[i] = gpio_pending_time[i]; pressed |= 1 << i;}
+            if (debug){print_stderr("GPIO%d %s, edge to handling: %.2lfms.\n", *gpio_pin[i], gpio_active[i] ? "pressed" : "released", (now - gpio_pending_time[i]) * 1000.);}
+        }
+        gpio_pending_time[i] = -1.;
+    }
+    return pressed;
+}
+
+static double gpio_deadline(void){ //earliest debounce period end, -1 if none pending
+    double deadline = -1., debounce = (gpio_cdev_fd >= 0) ? 0. : gpio_debounce_ms / 1000.;
+    for (int i=0; i<gpio_pins_count; i++){
+        if (gpio_pending_time[i] >= 0. && (deadline < 0. || gpio_pending_time[i] + debounce < deadline)){deadline = gpio_pending_time[i] + debounce;}
+    }
+    return deadline;
+}
+
+#if !(defined(NO_OSD) && defined(NO_TINYOSD))
+static bool gpio_held(int index, double now){ //pin active for at least hold duration
+    return gpio_hold_ms > 0 && gpio_active[index] && now - gpio_press_time[index] >= gpio_hold_ms / 1000.;
+}
 #endif
+#endif
+
+//sysfs attributes
+static int sysfs_attr_read(sysfs_attr_t* attr, char* buffer, int size){ //read attribute content from start using pread(), open on first use, reopen if device gone or file emptied, return length or -1 on failure
+    for (int retry = 0; retry < 2; retry++){
+        if (attr->fd < 0){
+            if (attr->path[0] == '\0' || (attr->fd = open(attr->path, O_RDONLY | O_CLOEXEC)) < 0){return -1;}
+        }
+        ssize_t len = pread(attr->fd, buffer, size - 1, 0);
+        if (len > 0){buffer[len] = '\0'; return (int)len;}
+        int err = errno; sysfs_attr_close(attr);
+        if (len < 0 && err != ENODEV && err != ENOENT && err != ESTALE){return -1;} //not worth a reopen
+    }
+    return -1;
+}
+
+static void sysfs_attr_close(sysfs_attr_t* attr){ //close attribute fd, reopened on next read
+    if (attr->fd >= 0){close(attr->fd); attr->fd = -1;}
+}
+
+static bool sysfs_attr_read_int(sysfs_attr_t* attr, int32_t* value){ //read attribute as integer, return false on failure
+    char buffer[32]; if (sysfs_attr_read(attr, buffer, sizeof(buffer)) < 0){return false;}
+    char *ptr = buffer; while (*ptr == ' ' || *ptr == '\t'){ptr++;}
+    bool negative = (*ptr == '-'); if (*ptr == '-' || *ptr == '+'){ptr++;}
+    if (*ptr < '0' || *ptr > '9'){return false;}
+    int64_t tmp = 0; while (*ptr >= '0' && *ptr <= '9'){if (tmp < INT32_MAX){tmp = tmp * 10 + (*ptr - '0');} ptr++;}
+    if (tmp > INT32_MAX){tmp = INT32_MAX;}
+    *value = (int32_t)(negative ? -tmp : tmp); return true;
+}
+
+#if !(defined(NO_OSD) && defined(NO_TINYOSD))
+static bool sysfs_attr_read_double(sysfs_attr_t* attr, double* value){ //read attribute as decimal number, return false on failure
+    char buffer[32]; if (sysfs_attr_read(attr, buffer, sizeof(buffer)) < 0){return false;}
+    char *ptr = buffer; while (*ptr == ' ' || *ptr == '\t'){ptr++;}
+    bool negative = (*ptr == '-'); if (*ptr == '-' || *ptr == '+'){ptr++;}
+    if ((*ptr < '0' || *ptr > '9') && *ptr != '.'){return false;}
+    double tmp = 0., divider = 1.;
+    while (*ptr >= '0' && *ptr <= '9'){tmp = tmp * 10. + (*ptr++ - '0');}
+    if (*ptr == '.'){ptr++; while (*ptr >= '0' && *ptr <= '9'){tmp = tmp * 10. + (*ptr++ - '0'); divider *= 10.;}}
+    *value = (negative ? -tmp : tmp) / divider; return true;
+}
+#endif
+
+//power supply uevents
+static bool uevent_init(void){ //open kernel uevent netlink socket (or test unix socket), return false on failure
+    char *ptr = strstr(battery_rsoc_path, "/power_supply/"); //power supply name from sysfs path
+    if (ptr != NULL){
+        ptr += 14; int len = 0; while (ptr[len] != '\0' && ptr[len] != '/'){len++;}
+        if (len < (int)sizeof(uevent_battery_name)){strncpy(uevent_battery_name, ptr, len); uevent_battery_name[len] = '\0';}
+    }
+
+    if (uevent_test_socket_path[0] != '\0'){ //test socket
+        struct sockaddr_un addr = {.sun_family = AF_UNIX}; strncpy(addr.sun_path, uevent_test_socket_path, sizeof(addr.sun_path) - 1);
+        unlink(uevent_test_socket_path);
+        if ((uevent_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0 || bind(uevent_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0){
+            print_stderr("failed to bind uevent test socket '%s', errno:%d.\n", uevent_test_socket_path, errno);
+            if (uevent_fd >= 0){close(uevent_fd); uevent_fd = -1;}
+            return false;
+        }
+    } else {
+        struct sockaddr_nl addr = {.nl_family = AF_NETLINK, .nl_groups = 1}; //kernel events group
+        if ((uevent_fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT)) < 0 || bind(uevent_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0){
+            print_stderr("failed to open uevent netlink socket, errno:%d.\n", errno);
+            if (uevent_fd >= 0){close(uevent_fd); uevent_fd = -1;}
+            return false;
+        }
+    }
+
+    if (!loop_fd_add(uevent_fd, LOOP_SRC_UEVENT, 0)){close(uevent_fd); uevent_fd = -1; return false;}
+    if (debug){print_stderr("Listening to power_supply uevents (%s), battery:'%s'\n", (uevent_test_socket_path[0] != '\0') ? uevent_test_socket_path : "netlink", uevent_battery_name);}
+    return true;
+}
+
+static bool uevent_process(void){ //read pending uevents, update battery data from power_supply change events, return true if battery capacity updated
+    bool ret = false; char buffer[uevent_buffer_size];
+    struct sockaddr_nl addr_nl; ssize_t len;
+    while (true){
+        socklen_t addr_len = sizeof(addr_nl);
+        if ((len = recvfrom(uevent_fd, buffer, sizeof(buffer) - 1, 0, (struct sockaddr*)&addr_nl, &addr_len)) <= 0){break;}
+        if (uevent_test_socket_path[0] == '\0' && addr_nl.nl_pid != 0){continue;} //not sent by kernel
+        buffer[len] = '\0';
+
+        //key=value pairs, NUL separated (kernel) or newline separated (test)
+        bool power_supply = false, change = false, name_match = (uevent_battery_name[0] == '\0');
+        int32_t capacity = -1, voltage = -1;
+        for (char *ptr = buffer; ptr < buffer + len;){
+            char *end = ptr; while (end < buffer + len && *end != '\0' && *end != '\n'){end++;} *end = '\0';
+            if (strcmp(ptr, "SUBSYSTEM=power_supply") == 0){power_supply = true;
+            } else if (strcmp(ptr, "ACTION=change") == 0){change = true;
+            } else if (strncmp(ptr, "POWER_SUPPLY_NAME=", 18) == 0){name_match = name_match || strcmp(ptr + 18, uevent_battery_name) == 0;
+            } else if (strncmp(ptr, "POWER_SUPPLY_CAPACITY=", 22) == 0){capacity = atoi(ptr + 22);
+            } else if (strncmp(ptr, "POWER_SUPPLY_VOLTAGE_NOW=", 25) == 0){voltage = atoi(ptr + 25);}
+            ptr = end + 1;
+        }
+        if (!power_supply || !change || !name_match){continue;}
+
+        if (capacity >= 0){
+            battery_rsoc_last = battery_rsoc; battery_rsoc = capacity; int_constrain(&battery_rsoc, 0, 100); ret = true;
+            if (!uevent_received){ //driver emits uevents, capacity polling only as safety net
+                sampler_sources[SAMPLER_BATTERY_RSOC].interval_ms = &uevent_safety_poll_ms; uevent_received = true;
+                if (debug){print_stderr("power_supply uevent received, battery capacity polling interval set to %dms\n", uevent_safety_poll_ms);}
+            }
+        }
+        #if !(defined(NO_OSD) && defined(NO_TINYOSD))
+            if (voltage >= 0){__atomic_store_n(&uevent_battery_voltage_raw, voltage, __ATOMIC_RELEASE); sampler_thread_wake();} //consumed by sampler thread
+        #endif
+        if (debug){print_stderr("power_supply uevent: capacity:%d, voltage:%d\n", capacity, voltage);}
+    }
+    return ret;
+}
 
 //low battery specific
-static bool lowbat_sysfs(void){ //read sysfs power_supply battery capacity, return true if threshold, false if under or file not found
+#ifndef NO_SIGNAL_FILE
+static bool signal_file_init(void){ //inotify instance watching signal file, return false on failure
+    const char *name = strrchr(signal_path, '/');
+    strncpy(signal_file_name, (name != NULL) ? name + 1 : signal_path, NAME_MAX);
+    if ((signal_file_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0 || !loop_fd_add(signal_file_inotify_fd, LOOP_SRC_SIGNAL_FILE, 0)){
+        print_stderr("inotify failed, errno:%d, signal file checked on each main loop wakeup.\n", errno);
+        if (signal_file_inotify_fd >= 0){close(signal_file_inotify_fd); signal_file_inotify_fd = -1;}
+        return false;
+    }
+    signal_file_watch();
+    return true;
+}
+
+static void signal_file_watch(void){ //(re)watch signal file, its parent directory if file doesn't exist yet
+    if (signal_file_wd >= 0){inotify_rm_watch(signal_file_inotify_fd, signal_file_wd);} //may already be removed by kernel
+    if ((signal_file_wd = inotify_add_watch(signal_file_inotify_fd, signal_path, IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF)) >= 0){
+        signal_file_dir_watched = false;
+        if (debug){print_stderr("Watching signal file '%s'.\n", signal_path);}
+        return;
+    }
+
+    char dir_path[PATH_MAX]; strncpy(dir_path, signal_path, PATH_MAX-1); dir_path[PATH_MAX-1] = '\0';
+    char *slash = strrchr(dir_path, '/');
+    if (slash == NULL){strcpy(dir_path, ".");} else if (slash == dir_path){slash[1] = '\0';} else {*slash = '\0';}
+    if ((signal_file_wd = inotify_add_watch(signal_file_inotify_fd, dir_path, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)) >= 0){
+        signal_file_dir_watched = true;
+        if (debug){print_stderr("Signal file '%s' doesn't exist, watching '%s'.\n", signal_path, dir_path);}
+    } else {print_stderr("Failed to watch '%s', errno:%d.\n", dir_path, errno);}
+}
+
+static void signal_file_process(void){ //read inotify events, flag signal file to be read if written, rewatch if created, deleted or replaced
+    char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    bool rewatch = false; ssize_t len;
+    while ((len = read(signal_file_inotify_fd, buffer, sizeof(buffer))) > 0){
+        for (char *ptr = buffer; ptr < buffer + len; ptr += sizeof(struct inotify_event) + ((struct inotify_event*)ptr)->len){
+            struct inotify_event *event = (struct inotify_event*)ptr;
+            if (event->wd != signal_file_wd){continue;} //previous watch
+            if (signal_file_dir_watched){
+                if (event->len > 0 && strcmp(event->name, signal_file_name) == 0){rewatch = true;} //signal file created or moved in place
+            } else if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)){rewatch = true; //deleted or replaced
+            } else if (event->mask & IN_CLOSE_WRITE){signal_file_pending = true;}
+        }
+    }
+    if (rewatch){signal_file_watch(); signal_file_pending = true;}
+}
+#endif
+
+//shared memory metrics
+static void shm_metrics_map(double now){ //map shared memory metrics file if not mapped yet and retry delay expired
+    if (shm_metrics_ptr != NULL || shm_metrics_path[0] == '\0' || now < shm_metrics_retry_time){return;}
+    shm_metrics_retry_time = now + shm_metrics_retry_interval;
+    fp_osd_shm_t *shm = fp_osd_shm_map(shm_metrics_path, false);
+    if (shm == NULL){return;} //producer not started yet
+    __atomic_store_n(&shm_metrics_ptr, shm, __ATOMIC_RELEASE); //sampler thread reads it
+    print_stderr("Shared memory metrics mapped from '%s'.\n", shm_metrics_path);
+}
+
+static bool shm_metrics_read(fp_osd_shm_t* dest){ //consistent copy of shared memory metrics, no syscall, return false if not mapped or invalid
+    fp_osd_shm_t *shm = __atomic_load_n(&shm_metrics_ptr, __ATOMIC_ACQUIRE);
+    return shm != NULL && fp_osd_shm_read(shm, dest);
+}
+
+static bool lowbat_sysfs(void){ //read battery capacity from shared memory metrics or sysfs power_supply, return true if threshold, false if under or file not found
     battery_rsoc_last = battery_rsoc;
-    FILE *filehandle = fopen(battery_rsoc_path, "r");
-    if (filehandle != NULL){
-        char buffer[5]; fgets(buffer, 5, filehandle); fclose(filehandle);
-        battery_rsoc = atoi(buffer); int_constrain(&battery_rsoc, 0, 100);
+    fp_osd_shm_t shm;
+    if (shm_metrics_read(&shm) && (shm.valid & FP_OSD_SHM_VALID_BATTERY_RSOC)){battery_rsoc = shm.battery_rsoc; //producer daemon
+    } else if (!sysfs_attr_read_int(&battery_rsoc_attr, &battery_rsoc)){battery_rsoc = -1;}
+    if (battery_rsoc > -1){
+        int_constrain(&battery_rsoc, 0, 100);
         if (battery_rsoc <= lowbat_limit){return true;}
-    } else {battery_rsoc = -1;}
+    }
     return false;
 }
 
 //cpu temperature specific
 static bool cputemp_sysfs(void){ //read sysfs cpu temperature, return true if threshold, false if under or file not found
     cputemp_last = cputemp_curr;
-    FILE *filehandle = fopen(cpu_thermal_path, "r");
-    if (filehandle != NULL){
-        fscanf(filehandle, "%d", &cputemp_curr);
-        fclose(filehandle);
+    if (sysfs_attr_read_int(&cpu_thermal_attr, &cputemp_curr)){
         cputemp_curr /= cpu_thermal_divider;
         cputemp_disp = cputemp_celsius ? cputemp_curr : (cputemp_curr * 9 / 5) + 32;
         if (cputemp_curr >= cputemp_crit){return true;}
@@ -406,10 +712,604 @@ static bool cputemp_sysfs(void){ //read sysfs cpu temperature, return true if th
     return false;
 }
 
+//data sources scheduler
+static bool sampler_due(int index, double now){ //check if data source deadline expired, schedule next deadline if so
+    sampler_source_t *source = &sampler_sources[index];
+    if (now < source->deadline){return false;}
+    source->deadline = now + (double)*source->interval_ms / 1000.;
+    return true;
+}
+
+#if !(defined(NO_OSD) && defined(NO_TINYOSD))
+static bool sampler_run(double now, uint8_t users){ //sample all data sources with a sampling function needed by given users and expired deadline, return true if any sampled
+    bool sampled = false;
+    for (int i=0; i<sampler_count; i++){
+        if (sampler_sources[i].sample == NULL || !(sampler_sources[i].users & users)){continue;}
+        if (sampler_due(i, now)){sampler_sources[i].sample(); sampled = true;}
+    }
+    return sampled;
+}
+#endif
+
+static double sampler_next_deadline(uint8_t users){ //earliest deadline of data sources needed by given users, -1 if none
+    double deadline = -1.;
+    for (int i=0; i<sampler_count; i++){
+        if (!(sampler_sources[i].users & users)){continue;}
+        if (deadline < 0. || sampler_sources[i].deadline < deadline){deadline = sampler_sources[i].deadline;}
+    }
+    return deadline;
+}
+
+#if !(defined(NO_OSD) && defined(NO_TINYOSD))
+static uint8_t sampler_users_active(void){ //data sources users currently active
+    uint8_t users = sampler_users_always;
+    #ifndef NO_OSD
+        if (osd_start_time > 0.){users |= sampler_users_osd;}
+    #endif
+    #ifndef NO_TINYOSD
+        if (tinyosd_start_time > 0.){users |= sampler_users_tinyosd;}
+    #endif
+    return users;
+}
+#endif
+
+//osd data sources
+#if !(defined(NO_OSD) && defined(NO_TINYOSD))
+static void* sampler_thread(void* arg){ //sample osd data sources on their deadlines, publish snapshot to main loop
+    rtnl_init(); //interfaces table
+    bool rtnl_event = false; //rtnetlink socket readable
+    while (!__atomic_load_n(&sampler_thread_stop, __ATOMIC_ACQUIRE)){
+        uint8_t users = __atomic_load_n(&sampler_users, __ATOMIC_ACQUIRE) & ~sampler_users_always; //always used sources handled by main loop
+        double now = get_time_double();
+        bool publish = sampler_run(now, users);
+        if (rtnl_event && rtnl_process() && users != 0){network_table_to_data(&sampler_data.network); publish = true;} //link or address changed, network data only
+        rtnl_event = false;
+        int32_t voltage_raw = __atomic_exchange_n(&uevent_battery_voltage_raw, -1, __ATOMIC_ACQ_REL); //battery voltage from power_supply uevent
+        if (voltage_raw >= 0){sampler_data.battery_voltage = (double)voltage_raw / battery_volt_divider; publish = true;}
+        if (publish){
+            osd_data_publish();
+            uint64_t value = 1; if (write(sampler_notify_fd, &value, sizeof(value)) < 0 && debug){print_stderr("failed to notify main loop, errno:%d.\n", errno);}
+        }
+
+        //sleep until next deadline or wake request
+        int timeout_ms = -1; double deadline = sampler_next_deadline(users);
+        if (deadline > 0.){timeout_ms = (int)((deadline - get_time_double()) * 1000. + .999); if (timeout_ms < 0){timeout_ms = 0;}}
+        struct pollfd wake_poll[2] = {{.fd = sampler_wake_fd, .events = POLLIN}, {.fd = rtnl_fd, .events = POLLIN}};
+        if (poll(wake_poll, (rtnl_fd != -1) ? 2 : 1, timeout_ms) > 0){
+            if (wake_poll[0].revents & POLLIN){uint64_t value; read(sampler_wake_fd, &value, sizeof(value));}
+            if (wake_poll[1].revents & POLLIN){rtnl_event = true;}
+        }
+    }
+    if (rtnl_fd != -1){close(rtnl_fd); rtnl_fd = -1;}
+    return NULL;
+}
+
+static bool sampler_thread_start(void){ //create eventfds and start sampler thread, return false on failure
+    if ((sampler_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0 || (sampler_notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0){print_stderr("eventfd() failed, errno:%d.\n", errno); return false;}
+    if (!loop_fd_add(sampler_notify_fd, LOOP_SRC_SAMPLER, 0)){return false;}
+    int ret = pthread_create(&sampler_thread_handle, NULL, sampler_thread, NULL);
+    if (ret != 0){print_stderr("pthread_create() failed, err:%d.\n", ret); return false;}
+    sampler_thread_started = true;
+    if (debug){print_stderr("Sampler thread started\n");}
+    return true;
+}
+
+static void sampler_thread_stop_join(void){ //request sampler thread close and wait for it
+    if (sampler_thread_started){
+        __atomic_store_n(&sampler_thread_stop, true, __ATOMIC_RELEASE);
+        uint64_t value = 1; write(sampler_wake_fd, &value, sizeof(value));
+        pthread_join(sampler_thread_handle, NULL); sampler_thread_started = false;
+        if (debug){print_stderr("Sampler thread stopped\n");}
+    }
+    if (sampler_wake_fd != -1){close(sampler_wake_fd); sampler_wake_fd = -1;}
+    if (sampler_notify_fd != -1){close(sampler_notify_fd); sampler_notify_fd = -1;}
+}
+
+static void sampler_users_set(uint8_t users){ //main thread: update data sources users, wake sampler thread if changed
+    if (users == __atomic_load_n(&sampler_users, __ATOMIC_RELAXED)){return;}
+    __atomic_store_n(&sampler_users, users, __ATOMIC_RELEASE);
+    sampler_thread_wake();
+}
+
+static void sampler_thread_wake(void){ //wake sampler thread
+    if (sampler_wake_fd != -1){uint64_t value = 1; write(sampler_wake_fd, &value, sizeof(value));}
+}
+
+static void osd_data_publish(void){ //sampler thread: copy working data to shared snapshot, seqlock write side
+    uint32_t seq = __atomic_load_n(&osd_data_seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&osd_data_seq, seq + 1, __ATOMIC_RELAXED); //odd: write in progress
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    sampler_data.version++;
+    memcpy(&osd_data_shared, &sampler_data, sizeof(osd_data_t));
+    __atomic_store_n(&osd_data_seq, seq + 2, __ATOMIC_RELEASE); //even: snapshot consistent
+}
+
+static void osd_data_snapshot(osd_data_t* dest){ //main thread: consistent copy of shared snapshot, seqlock read side
+    uint32_t seq;
+    do {
+        while ((seq = __atomic_load_n(&osd_data_seq, __ATOMIC_ACQUIRE)) & 1){} //write in progress
+        memcpy(dest, &osd_data_shared, sizeof(osd_data_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (seq != __atomic_load_n(&osd_data_seq, __ATOMIC_RELAXED)); //retry if published meanwhile
+}
+
+static uint32_t uptime_get(void){ //system uptime in sec
+    struct timespec tp = {0}; clock_gettime(CLOCK_BOOTTIME, &tp);
+    return (uint32_t)tp.tv_sec;
+}
+
+static void battery_voltage_sample(void){ //read battery voltage file
+    double batt_voltage = -1.; fp_osd_shm_t shm;
+    if (shm_metrics_read(&shm) && (shm.valid & FP_OSD_SHM_VALID_BATTERY_VOLTAGE)){batt_voltage = (double)shm.battery_voltage_uv / 1000000.; //producer daemon
+    } else if (sysfs_attr_read_double(&battery_volt_attr, &batt_voltage)){batt_voltage /= battery_volt_divider;} else {batt_voltage = -1.;}
+    sampler_data.battery_voltage = batt_voltage;
+}
+
+static void cpu_load_sample(void){ //sample /proc/stat through persistent fd without blocking, update cpu load from delta with previous sample
+    static double sample_time_prev = -1.; static uint64_t busy_prev = 0, total_prev = 0;
+    double sample_time = get_time_double();
+    if (sample_time_prev > 0. && sample_time - sample_time_prev > 2. * refresh_cpu_load_ms / 1000.){sample_time_prev = -1.; sampler_data.cpu_load = -1;} //previous sample too old (osd hidden meanwhile), restart
+
+    char buffer[256]; //aggregated cpu line fits, per cpu lines not needed
+    if (sysfs_attr_read(&proc_stat_attr, buffer, sizeof(buffer)) < 0){sampler_data.cpu_load = -1; return;}
+    unsigned long long user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0, softirq = 0, steal = 0;
+    int count = sscanf(buffer, "%*s %llu %llu %llu %llu %llu %llu %llu %llu", &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
+    if (count < 4){sampler_data.cpu_load = -1; return;} //cpu line not parsed
+
+    uint64_t busy = user + nice + system + irq + softirq + steal, total = busy + idle + iowait;
+    if (sample_time_prev > 0. && total > total_prev){
+        sampler_data.cpu_load = (int32_t)((busy - busy_prev) * 100 / (total - total_prev));
+        int_constrain(&sampler_data.cpu_load, 0, 100);
+    }
+    busy_prev = busy; total_prev = total; sample_time_prev = sample_time;
+}
+
+static void backlight_sample(void){ //backlight current and maximum value from shared memory metrics, files otherwise
+    int32_t backlight = -1, backlight_max = -1; fp_osd_shm_t shm;
+    bool shm_valid = shm_metrics_read(&shm);
+    if (shm_valid && (shm.valid & FP_OSD_SHM_VALID_BACKLIGHT)){backlight = shm.backlight;
+    } else if (!sysfs_attr_read_int(&backlight_attr, &backlight)){backlight = -1;}
+    if (shm_valid && (shm.valid & FP_OSD_SHM_VALID_BACKLIGHT_MAX)){backlight_max = shm.backlight_max;
+    } else if (!sysfs_attr_read_int(&backlight_max_attr, &backlight_max)){backlight_max = -1;}
+    sampler_data.backlight = backlight; sampler_data.backlight_max = backlight_max;
+}
+
+static void network_sample(void){ //interfaces ipv4 addresses, wifi link speed and signal
+    osd_network_data_t network_data = {0};
+    char buffer[256];
+
+    if (rtnl_fd != -1){network_table_to_data(&network_data); //interfaces table maintained from rtnetlink events
+    } else { //fallback
+        struct ifaddrs *ifap, *ifa;
+        if (getifaddrs(&ifap) == 0){
+            for (ifa = ifap; ifa; ifa = ifa->ifa_next){
+                if (!(ifa->ifa_flags & IFF_LOOPBACK) && ifa->ifa_addr && ifa->ifa_addr->sa_family == AF_INET){
+                    char* ip = inet_ntoa(((struct sockaddr_in *) ifa->ifa_addr)->sin_addr);
+                    struct osd_if_struct *ptr = &network_data.interface[network_data.count];
+                    strncpy(ptr->name, ifa->ifa_name, IF_NAMESIZE-1);
+                    strncpy(ptr->ipv4, ip, 15);
+                    ptr->up = ifa->ifa_flags & IFF_UP;
+                    network_data.count++;
+                    if (network_data.count >= network_data_limit){break;}
+                }
+            }
+            freeifaddrs(ifap);
+        }
+    }
+
+    //wifi link speed and signal
+    bool wireless_available = wifi_proc_wireless_read(&network_data); //signal from /proc/net/wireless
+    if (nl80211_family_id == 0){nl80211_family_id = nl80211_init();} //resolve nl80211 family once
+    for (int i=0; i<network_data.count; i++){
+        struct osd_if_struct *ptr = &network_data.interface[i];
+        wifi_cache_t *cache = wifi_cache_get(ptr->name);
+        if (cache == NULL || cache->wireless == 0){continue;} //known not wireless
+        if (ptr->signal != 0){cache->wireless = 1;}
+
+        if (nl80211_family_id > 0){ //bitrate (and signal if missing) from nl80211 station info
+            int ret = nl80211_station_get(cache->ifindex, &ptr->speed, &ptr->signal);
+            if (ret == -1 && cache->wireless != 1){cache->wireless = 0; //not a wireless interface
+            } else if (ret == -2 && cache->wireless == 1){ptr->speed = cache->speed; if (ptr->signal == 0){ptr->signal = cache->signal;} //query failed, reuse last values
+            } else if (ret > 0){cache->wireless = 1;}
+        } else if (!wireless_available && access("/sbin/iw", F_OK) == 0){ //fallback: neither nl80211 nor /proc/net/wireless available
+            int* tmp_speed = &ptr->speed;
+            int* tmp_signal = &ptr->signal;
+            sprintf(buffer, "iw dev %s link 2> /dev/null", ptr->name); //build commandline
+            pid_t command_pid; FILE *filehandle = command_popen(buffer, &command_pid);
+            if(filehandle != NULL){
+                while(fgets(buffer, 255, filehandle) != NULL){
+                    if(*tmp_signal == 0 && strstr(buffer, "signal") != NULL){sscanf(buffer, "%*[^0123456789]%d", tmp_signal); //signal
+                    }else if(*tmp_speed == 0 && strstr(buffer, "rx bitrate") != NULL){sscanf(buffer, "%*[^0123456789]%d", tmp_speed);} //speed, same direction as nl80211
+                    if (*tmp_signal != 0 && *tmp_speed != 0){break;}
+                }
+                command_pclose(filehandle, command_pid);
+            }
+        }
+        cache->speed = ptr->speed; cache->signal = ptr->signal;
+    }
+
+    sampler_data.network = network_data;
+}
+
+static bool rtnl_init(void){ //open rtnetlink socket subscribed to link and ipv4 address changes, dump current interfaces, return false on failure
+    struct sockaddr_nl addr = {.nl_family = AF_NETLINK, .nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR};
+    if ((rtnl_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE)) < 0 || bind(rtnl_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0){
+        print_stderr("rtnetlink socket failed, errno:%d, fall back to getifaddrs().\n", errno);
+        if (rtnl_fd >= 0){close(rtnl_fd); rtnl_fd = -1;}
+        return false;
+    }
+    struct timeval timeout = {.tv_sec = 0, .tv_usec = 200000}; //dumps only, events read without blocking
+    setsockopt(rtnl_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    rtnl_dump();
+    if (debug){network_table_print("initial dump");}
+    return true;
+}
+
+static bool rtnl_dump(void){ //rebuild interfaces table from link and ipv4 address dumps, return false if events were lost meanwhile
+    network_table_count = 0; bool complete = true;
+    uint16_t dump_types[2] = {RTM_GETLINK, RTM_GETADDR}; //links first so addresses find their interface
+    for (int i=0; i<2; i++){
+        struct {struct nlmsghdr nlh; struct rtgenmsg gen;} request = {
+            .nlh = {.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtgenmsg)), .nlmsg_type = dump_types[i], .nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP, .nlmsg_seq = i + 1},
+            .gen = {.rtgen_family = (i == 0) ? AF_UNSPEC : AF_INET},
+        };
+        if (send(rtnl_fd, &request, request.nlh.nlmsg_len, 0) < 0){print_stderr("rtnetlink dump request failed, errno:%d.\n", errno); continue;}
+        bool changed; int ret;
+        while ((ret = rtnl_process_messages(0, &changed)) > 0 || ret == -2){if (ret == -2){complete = false;}} //overflow error reported once, dump reply still follows
+    }
+    return complete;
+}
+
+static int rtnl_process_messages(int flags, bool* changed){ //receive one netlink datagram and update interfaces table, return 0 on end of dump, -1 on failure or nothing pending, -2 if socket buffer overflowed (events lost), 1 otherwise
+    char buffer[8192];
+    ssize_t len = recv(rtnl_fd, buffer, sizeof(buffer), flags);
+    if (len < 0 && errno == ENOBUFS){return -2;}
+    if (len <= 0){return -1;}
+    for (struct nlmsghdr *nlh = (struct nlmsghdr*)buffer; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)){
+        if (nlh->nlmsg_type == NLMSG_DONE || nlh->nlmsg_type == NLMSG_ERROR){return 0;} //end of dump
+
+        if (nlh->nlmsg_type == RTM_NEWLINK || nlh->nlmsg_type == RTM_DELLINK){
+            struct ifinfomsg *ifi = (struct ifinfomsg*)NLMSG_DATA(nlh);
+            int attr_len = IFLA_PAYLOAD(nlh); char *name = NULL;
+            for (struct rtattr *rta = IFLA_RTA(ifi); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len)){if (rta->rta_type == IFLA_IFNAME){name = (char*)RTA_DATA(rta);}}
+            network_table_t *entry = network_table_get(ifi->ifi_index, nlh->nlmsg_type == RTM_NEWLINK);
+            if (entry == NULL){continue;}
+            if (nlh->nlmsg_type == RTM_DELLINK){ //remove interface
+                *entry = network_table[--network_table_count]; *changed = true;
+            } else {
+                bool up = ifi->ifi_flags & IFF_UP, loopback = ifi->ifi_flags & IFF_LOOPBACK;
+                if (entry->up != up || entry->loopback != loopback || (name != NULL && strncmp(entry->name, name, IF_NAMESIZE) != 0)){*changed = true;}
+                entry->up = up; entry->loopback = loopback;
+                if (name != NULL){strncpy(entry->name, name, IF_NAMESIZE-1);}
+            }
+        } else if (nlh->nlmsg_type == RTM_NEWADDR || nlh->nlmsg_type == RTM_DELADDR){
+            struct ifaddrmsg *ifa = (struct ifaddrmsg*)NLMSG_DATA(nlh);
+            if (ifa->ifa_family != AF_INET){continue;}
+            int attr_len = IFA_PAYLOAD(nlh); struct in_addr *ip = NULL;
+            for (struct rtattr *rta = IFA_RTA(ifa); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len)){
+                if (rta->rta_type == IFA_LOCAL || (rta->rta_type == IFA_ADDRESS && ip == NULL)){ip = (struct in_addr*)RTA_DATA(rta);} //local address preferred on point to point links
+            }
+            network_table_t *entry = network_table_get(ifa->ifa_index, false);
+            if (entry == NULL || ip == NULL){continue;}
+            char ipv4[16]; inet_ntop(AF_INET, ip, ipv4, sizeof(ipv4));
+            int j = 0; while (j < entry->ipv4_count && strcmp(entry->ipv4[j], ipv4) != 0){j++;} //known address index
+            if (nlh->nlmsg_type == RTM_NEWADDR && j == entry->ipv4_count && j < network_table_ipv4_limit){
+                strcpy(entry->ipv4[entry->ipv4_count++], ipv4); if (j == 0){*changed = true;} //first address displayed
+            } else if (nlh->nlmsg_type == RTM_DELADDR && j < entry->ipv4_count){
+                memmove(entry->ipv4[j], entry->ipv4[j+1], (--entry->ipv4_count - j) * sizeof(entry->ipv4[0])); //next remaining address displayed if first removed
+                entry->ipv4[entry->ipv4_count][0] = '\0';
+                if (j == 0){*changed = true;}
+            }
+        }
+    }
+    return 1;
+}
+
+static bool rtnl_process(void){ //read all pending rtnetlink events, return true if interfaces table changed
+    bool changed = false; int ret;
+    while ((ret = rtnl_process_messages(MSG_DONTWAIT, &changed)) >= 0);
+    if (ret == -2){ //events lost, table may be stale
+        print_stderr("rtnetlink socket buffer overflow, dump interfaces again.\n");
+        for (int i=0; i<3 && !rtnl_dump(); i++); //retry while events keep getting lost
+        changed = true;
+    }
+    if (changed && debug){network_table_print("changed");}
+    return changed;
+}
+
+static network_table_t* network_table_get(int index, bool create){ //interfaces table entry from interface index, created if needed and allowed, NULL otherwise
+    for (int i=0; i<network_table_count; i++){if (network_table[i].index == index){return &network_table[i];}}
+    if (!create || network_table_count >= network_table_limit){return NULL;}
+    network_table_t *entry = &network_table[network_table_count++];
+    memset(entry, 0, sizeof(network_table_t)); entry->index = index;
+    return entry;
+}
+
+static void network_table_print(const char* reason){ //debug output of interfaces table
+    print_stderr("rtnetlink interfaces table (%s): %d interface(s)\n", reason, network_table_count);
+    for (int i=0; i<network_table_count; i++){print_stderr("\t%d: %s, %s%s, ipv4:%s (%d address(es))\n", network_table[i].index, network_table[i].name, network_table[i].up?"up":"down", network_table[i].loopback?", loopback":"", network_table[i].ipv4[0], network_table[i].ipv4_count);}
+}
+
+static void network_table_to_data(osd_network_data_t* network_data){ //non loopback interfaces with ipv4 address from interfaces table, wifi values from cache, no syscall
+    network_data->count = 0;
+    for (int i=0; i<network_table_count && network_data->count < network_data_limit; i++){
+        network_table_t *entry = &network_table[i];
+        if (entry->loopback || entry->ipv4_count == 0){continue;}
+        struct osd_if_struct *ptr = &network_data->interface[network_data->count++];
+        memset(ptr, 0, sizeof(struct osd_if_struct));
+        strncpy(ptr->name, entry->name, IF_NAMESIZE-1); strncpy(ptr->ipv4, entry->ipv4[0], 15); ptr->up = entry->up;
+        for (int j=0; j<wifi_cache_count; j++){
+            if (wifi_cache[j].ifindex == entry->index && wifi_cache[j].wireless == 1){ptr->speed = wifi_cache[j].speed; ptr->signal = wifi_cache[j].signal; break;}
+        }
+    }
+}
+
+static wifi_cache_t* wifi_cache_get(const char* name){ //per interface wireless cache entry, created if needed, NULL if cache full
+    int ifindex = (int)if_nametoindex(name);
+    for (int i=0; i<wifi_cache_count; i++){
+        if (strcmp(wifi_cache[i].name, name) == 0){
+            if (wifi_cache[i].ifindex != ifindex){wifi_cache[i].ifindex = ifindex; wifi_cache[i].wireless = -1;} //interface recreated
+            return &wifi_cache[i];
+        }
+    }
+    if (wifi_cache_count >= network_data_limit){return NULL;}
+    wifi_cache_t *cache = &wifi_cache[wifi_cache_count++];
+    strncpy(cache->name, name, IF_NAMESIZE-1); cache->ifindex = ifindex; cache->wireless = -1;
+    return cache;
+}
+
+static bool wifi_proc_wireless_read(osd_network_data_t* network_data){ //signal level from /proc/net/wireless for listed interfaces, return false if file not available
+    char buffer[1024]; if (sysfs_attr_read(&wireless_attr, buffer, sizeof(buffer)) < 0){return false;}
+    char *ptr = buffer;
+    for (int line = 0; *ptr != '\0'; line++){
+        char *end = strchr(ptr, '\n'); if (end != NULL){*end = '\0';}
+        if (line >= 2){ //skip headers, " wlan0: 0000   70.  -40.  -256 ..."
+            char *name = ptr; while (*name == ' '){name++;}
+            char *sep = strchr(name, ':');
+            if (sep != NULL){
+                *sep = '\0'; int status = 0; double link = 0., level = 0.;
+                if (sscanf(sep + 1, "%x %lf %lf", &status, &link, &level) == 3){
+                    for (int i=0; i<network_data->count; i++){
+                        if (strcmp(network_data->interface[i].name, name) == 0){network_data->interface[i].signal = (level < 0.) ? (int)(-level) : 0; break;}
+                    }
+                }
+            }
+        }
+        if (end == NULL){break;}
+        ptr = end + 1;
+    }
+    return true;
+}
+
+static int nl80211_send(uint16_t type, uint16_t flags, uint8_t cmd, uint16_t attr_type, const void* attr_data, uint16_t attr_len){ //send generic netlink request with a single attribute, return sequence number or -1 on failure
+    char buffer[128] = {0};
+    struct nlmsghdr *nlh = (struct nlmsghdr*)buffer;
+    struct genlmsghdr *genlh = (struct genlmsghdr*)NLMSG_DATA(nlh);
+    struct nlattr *nla = (struct nlattr*)((char*)genlh + GENL_HDRLEN);
+    nla->nla_type = attr_type; nla->nla_len = NLA_HDRLEN + attr_len; memcpy((char*)nla + NLA_HDRLEN, attr_data, attr_len);
+    genlh->cmd = cmd; genlh->version = 1;
+    nlh->nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN + NLA_ALIGN(nla->nla_len)); nlh->nlmsg_type = type; nlh->nlmsg_flags = NLM_F_REQUEST | flags; nlh->nlmsg_seq = ++nl80211_seq;
+    if (send(nl80211_fd, buffer, nlh->nlmsg_len, 0) < 0){return -1;}
+    return (int)nl80211_seq;
+}
+
+static void nla_parse_flat(struct nlattr* attrs[], int max, void* data, int len){ //index attributes by type, nested attributes not parsed
+    for (int i=0; i<=max; i++){attrs[i] = NULL;}
+    struct nlattr *nla = (struct nlattr*)data;
+    while (len >= NLA_HDRLEN && nla->nla_len >= NLA_HDRLEN && nla->nla_len <= len){
+        int type = nla->nla_type & NLA_TYPE_MASK; if (type <= max){attrs[type] = nla;}
+        len -= NLA_ALIGN(nla->nla_len); nla = (struct nlattr*)((char*)nla + NLA_ALIGN(nla->nla_len));
+    }
+}
+
+static int nl80211_init(void){ //open generic netlink socket and resolve nl80211 family id, return id or -1 if not available
+    if ((nl80211_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC)) < 0){print_stderr("generic netlink socket failed, errno:%d.\n", errno); return -1;}
+    struct sockaddr_nl addr = {.nl_family = AF_NETLINK};
+    struct timeval timeout = {.tv_sec = 0, .tv_usec = 100000}; //never block sampler thread for long
+    setsockopt(nl80211_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (bind(nl80211_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || nl80211_send(GENL_ID_CTRL, 0, CTRL_CMD_GETFAMILY, CTRL_ATTR_FAMILY_NAME, NL80211_GENL_NAME, strlen(NL80211_GENL_NAME) + 1) < 0){
+        close(nl80211_fd); nl80211_fd = -1; return -1;
+    }
+
+    int family_id = -1; char buffer[4096];
+    ssize_t len = recv(nl80211_fd, buffer, sizeof(buffer), 0);
+    for (struct nlmsghdr *nlh = (struct nlmsghdr*)buffer; len > 0 && NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)){
+        if (nlh->nlmsg_type != GENL_ID_CTRL){break;} //error, family not found
+        struct nlattr *attrs[CTRL_ATTR_MAX + 1];
+        nla_parse_flat(attrs, CTRL_ATTR_MAX, (char*)NLMSG_DATA(nlh) + GENL_HDRLEN, nlh->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN));
+        if (attrs[CTRL_ATTR_FAMILY_ID] != NULL){family_id = *(uint16_t*)((char*)attrs[CTRL_ATTR_FAMILY_ID] + NLA_HDRLEN);}
+    }
+    if (family_id < 0){close(nl80211_fd); nl80211_fd = -1;}
+    if (debug){print_stderr("nl80211 family id:%d\n", family_id);}
+    return family_id;
+}
+
+static int nl80211_station_get(int ifindex, int* speed, int* signal){ //first station of interface (access point in managed mode), rx bitrate in Mbit/s, signal in -dBm if not set yet, return 1 if found, 0 if not connected, -1 if not wireless, -2 on failure
+    uint32_t index = (uint32_t)ifindex;
+    if (ifindex <= 0){return -1;}
+    int seq = nl80211_send((uint16_t)nl80211_family_id, NLM_F_DUMP, NL80211_CMD_GET_STATION, NL80211_ATTR_IFINDEX, &index, sizeof(index));
+    if (seq < 0){return -2;}
+
+    int ret = 0; bool done = false; char buffer[8192];
+    while (!done){
+        ssize_t len = recv(nl80211_fd, buffer, sizeof(buffer), 0);
+        if (len <= 0){return -2;} //timeout or failure
+        for (struct nlmsghdr *nlh = (struct nlmsghdr*)buffer; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)){
+            if (nlh->nlmsg_seq != (uint32_t)seq){continue;} //stale reply from a previous timed out request
+            if (nlh->nlmsg_type == NLMSG_DONE){done = true; break;}
+            if (nlh->nlmsg_type == NLMSG_ERROR){ret = -1; done = true; break;} //ENODEV, EOPNOTSUPP: not a wireless interface
+            if (ret > 0){continue;} //first station only, drain dump
+
+            struct nlattr *attrs[NL80211_ATTR_MAX + 1], *sta_info[NL80211_STA_INFO_MAX + 1], *rate_info[NL80211_RATE_INFO_MAX + 1];
+            nla_parse_flat(attrs, NL80211_ATTR_MAX, (char*)NLMSG_DATA(nlh) + GENL_HDRLEN, nlh->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN));
+            if (attrs[NL80211_ATTR_STA_INFO] == NULL){continue;}
+            nla_parse_flat(sta_info, NL80211_STA_INFO_MAX, (char*)attrs[NL80211_ATTR_STA_INFO] + NLA_HDRLEN, attrs[NL80211_ATTR_STA_INFO]->nla_len - NLA_HDRLEN);
+            if (*signal == 0 && sta_info[NL80211_STA_INFO_SIGNAL] != NULL){*signal = -(int)*(int8_t*)((char*)sta_info[NL80211_STA_INFO_SIGNAL] + NLA_HDRLEN);}
+            if (sta_info[NL80211_STA_INFO_RX_BITRATE] != NULL){
+                nla_parse_flat(rate_info, NL80211_RATE_INFO_MAX, (char*)sta_info[NL80211_STA_INFO_RX_BITRATE] + NLA_HDRLEN, sta_info[NL80211_STA_INFO_RX_BITRATE]->nla_len - NLA_HDRLEN);
+                if (rate_info[NL80211_RATE_INFO_BITRATE32] != NULL){*speed = *(uint32_t*)((char*)rate_info[NL80211_RATE_INFO_BITRATE32] + NLA_HDRLEN) / 10; //100kbit/s unit
+                } else if (rate_info[NL80211_RATE_INFO_BITRATE] != NULL){*speed = *(uint16_t*)((char*)rate_info[NL80211_RATE_INFO_BITRATE] + NLA_HDRLEN) / 10;}
+            }
+            ret = 1;
+        }
+    }
+    return ret;
+}
+
+static void time_sync_sample(void){ //check if rtc module installed or system time synchronized with ntc service
+    if (sampler_data.time_rtc || sampler_data.time_ntc){return;} //no need to recheck once detected
+    static bool rtc_checked = false;
+    if (!rtc_checked){rtc_checked = true; //rtc check, once, module presence doesn't change at runtime
+        if (access(rtc_path, F_OK) == 0){sampler_data.time_rtc = true; return;}
+    }
+    struct timex timex_data = {.modes = 0}; //read only, kernel ntp state maintained by any ntp client (systemd-timesyncd, chrony, ntpd)
+    int clock_state = adjtimex(&timex_data);
+    if (clock_state != -1 && clock_state != TIME_ERROR && !(timex_data.status & STA_UNSYNC) && timex_data.maxerror < time_sync_maxerror_limit){
+        sampler_data.time_ntc = true;
+        if (debug){print_stderr("DEBUG: clock synchronized, state:%d, maxerror:%ldus.\n", clock_state, timex_data.maxerror);}
+    }
+}
+#endif
+
+#ifndef NO_OSD
+static bool meminfo_read(meminfo_t* meminfo){ //single pread of /proc/meminfo, exact key match in one pass, stop once all fields found, fields in kB, -1 if not found, return false on failure
+    static const struct {const char* key; uint8_t len; uint8_t offset;} fields[] = {
+        {"MemTotal:", 9, offsetof(meminfo_t, mem_total)}, {"MemFree:", 8, offsetof(meminfo_t, mem_free)}, {"MemAvailable:", 13, offsetof(meminfo_t, mem_available)},
+        {"Buffers:", 8, offsetof(meminfo_t, buffers)}, {"Cached:", 7, offsetof(meminfo_t, cached)},
+        {"SwapTotal:", 10, offsetof(meminfo_t, swap_total)}, {"SwapFree:", 9, offsetof(meminfo_t, swap_free)},
+    };
+    const int fields_count = sizeof(fields) / sizeof(fields[0]);
+
+    char buffer[4096]; int len = sysfs_attr_read(&meminfo_attr, buffer, sizeof(buffer));
+    for (int i=0; i<fields_count; i++){*(int32_t*)((char*)meminfo + fields[i].offset) = -1;}
+    if (len < 0){return false;}
+
+    int found = 0; uint8_t found_mask = 0;
+    for (char *ptr = buffer; *ptr != '\0' && found < fields_count;){
+        for (int i=0; i<fields_count; i++){
+            if (!(found_mask & (1 << i)) && strncmp(ptr, fields[i].key, fields[i].len) == 0){ //exact key, "Cached:" does not match "SwapCached:"
+                char *val = ptr + fields[i].len; while (*val == ' '){val++;}
+                int32_t tmp = 0; while (*val >= '0' && *val <= '9'){tmp = tmp * 10 + (*val++ - '0');}
+                *(int32_t*)((char*)meminfo + fields[i].offset) = tmp; found_mask |= 1 << i; found++;
+                break;
+            }
+        }
+        while (*ptr != '\0' && *ptr != '\n'){ptr++;} //next line
+        if (*ptr == '\n'){ptr++;}
+    }
+    return true;
+}
+
+static void memory_sample(void){ //ram and swap usage from /proc/meminfo
+    meminfo_t meminfo;
+    if (meminfo_read(&meminfo) && meminfo.mem_total >= 0 && meminfo.mem_free >= 0){
+        sampler_data.memory_total = meminfo.mem_total / memory_divider;
+        sampler_data.memory_used = sampler_data.memory_total - (meminfo.mem_free + (meminfo.buffers > 0 ? meminfo.buffers : 0) + (meminfo.cached > 0 ? meminfo.cached : 0)) / memory_divider;
+        if (meminfo.swap_total >= 0 && meminfo.swap_free >= 0){
+            sampler_data.swap_total = meminfo.swap_total / memory_divider;
+            sampler_data.swap_used = sampler_data.swap_total - meminfo.swap_free / memory_divider;
+        } else {sampler_data.swap_used = -1;}
+    } else {sampler_data.memory_used = sampler_data.swap_used = -1;}
+}
+
+#ifdef MEMINFO_BENCHMARK
+static void meminfo_benchmark(void){ //compare meminfo_read() against previous fopen/fgets/strstr loop
+    const int loops = 10000;
+    double start_time = get_time_double();
+    for (int loop=0; loop<loops; loop++){ //previous implementation
+        char buffer[256];
+        int32_t memory_total = 0, swap_total = 0, mem_free = -1, mem_buffers = -1, mem_chached = -1, swap_free = -1;
+        FILE *filehandle = fopen("/proc/meminfo", "r");
+        if (filehandle != NULL){
+            while (fgets (buffer, 255, filehandle) != NULL){
+                if (memory_total == 0 && strstr(buffer, "MemTotal") != NULL){sscanf(buffer, "%*[^0123456789]%d", &memory_total);}
+                if (mem_free == -1 && strstr(buffer, "MemFree") != NULL){sscanf(buffer, "%*[^0123456789]%d", &mem_free);}
+                if (mem_buffers == -1 && strstr(buffer, "Buffers") != NULL){sscanf(buffer, "%*[^0123456789]%d", &mem_buffers);}
+                if (mem_chached == -1 && strstr(buffer, "Cached") != NULL){sscanf(buffer, "%*[^0123456789]%d", &mem_chached);}
+                if (swap_total == 0 && strstr(buffer, "SwapTotal") != NULL){sscanf(buffer, "%*[^0123456789]%d", &swap_total);}
+                if (swap_free == -1 && strstr(buffer, "SwapFree") != NULL){sscanf(buffer, "%*[^0123456789]%d", &swap_free);}
+                if (memory_total != 0 && mem_free != -1 && mem_buffers != -1 && mem_chached != -1 && swap_free != -1){break;}
+            }
+            fclose(filehandle);
+        }
+    }
+    double legacy_duration = get_time_double() - start_time;
+
+    meminfo_t meminfo; start_time = get_time_double();
+    for (int loop=0; loop<loops; loop++){meminfo_read(&meminfo);}
+    double duration = get_time_double() - start_time;
+
+    print_stderr("meminfo benchmark (%d loops): fopen/fgets/strstr: %.2lfus per call, meminfo_read(): %.2lfus per call (%.1lfx)\n", loops, legacy_duration * 1000000. / loops, duration * 1000000. / loops, legacy_duration / duration);
+    print_stderr("meminfo: MemTotal:%d MemFree:%d MemAvailable:%d Buffers:%d Cached:%d SwapTotal:%d SwapFree:%d\n", meminfo.mem_total, meminfo.mem_free, meminfo.mem_available, meminfo.buffers, meminfo.cached, meminfo.swap_total, meminfo.swap_free);
+}
+#endif
+
+static int gencmd_vc(char* response, int len, const char* cmd){ //videocore gencmd provider, return 0 on success
+    return vc_gencmd(response, len, "%s", cmd);
+}
+
+static int gencmd_stub(char* response, int len, const char* cmd){ //test gencmd provider, response from 'command:response' line of gencmd_stub_path file, return 0 on success
+    int ret = -1; char buffer[256]; size_t cmd_len = strlen(cmd);
+    FILE *filehandle = fopen(gencmd_stub_path, "r");
+    if (filehandle == NULL){return -1;}
+    while (fgets(buffer, sizeof(buffer), filehandle) != NULL){
+        if (strncmp(buffer, cmd, cmd_len) == 0 && buffer[cmd_len] == ':'){
+            buffer[strcspn(buffer, "\r\n")] = '\0';
+            snprintf(response, len, "%s", buffer + cmd_len + 1); ret = 0; break;
+        }
+    }
+    fclose(filehandle);
+    return ret;
+}
+
+static const char* gencmd_cached(int index, double now){ //gencmd response from cache, query provider if expired, NULL if never succeeded
+    gencmd_cache_t *entry = &gencmd_cache[index];
+    if (entry->time >= 0. && (entry->ttl_ms < 0 || now - entry->time < entry->ttl_ms / 1000.)){ //still valid
+        __atomic_add_fetch(&gencmd_cache_hits, 1, __ATOMIC_RELAXED);
+        return entry->response;
+    }
+    __atomic_add_fetch(&gencmd_cache_misses, 1, __ATOMIC_RELAXED);
+    char buffer[sizeof(entry->response)];
+    if (gencmd_provider(buffer, sizeof(buffer), entry->cmd) == 0 && strchr(buffer, '=') != NULL){ //valid responses are 'key=value'
+        strcpy(entry->response, buffer); entry->time = now;
+    } else if (debug){print_stderr("gencmd '%s' failed\n", entry->cmd);}
+    return (entry->time >= 0.) ? entry->response : NULL; //previous response if query failed
+}
+
+static void gpu_memory_sample(void){ //gpu memory usage from videocore
+    double now = get_time_double();
+    int32_t memory[4] = {0}; //malloc_total, reloc_total, malloc, reloc
+    for (int i=0; i<4; i++){
+        const char* response = gencmd_cached(GENCMD_MALLOC_TOTAL + i, now);
+        if (response != NULL){sscanf(response, "%*[^0123456789]%d", &memory[i]);} //'malloc=8M'
+    }
+
+    if (memory[0] + memory[1] > 0){sampler_data.gpu_memory_total = memory[0] + memory[1];} //total: malloc_total + reloc_total
+    if (sampler_data.gpu_memory_total > 0){sampler_data.gpu_memory_used = sampler_data.gpu_memory_total - (memory[2] + memory[3]);} //free: malloc + reloc
+}
+
+static void throttled_sample(void){ //videocore undervoltage and throttling flags
+    const char* response = gencmd_cached(GENCMD_THROTTLED, get_time_double());
+    unsigned int flags;
+    if (response != NULL && sscanf(response, "throttled=%x", &flags) == 1){sampler_data.throttled = flags;} //'throttled=0x50005'
+}
+
+static void shm_sample(void){ //gamepad status and custom values from shared memory metrics
+    fp_osd_shm_t shm;
+    if (!shm_metrics_read(&shm)){sampler_data.gamepad_status = -1; sampler_data.custom_valid = 0; return;}
+    sampler_data.gamepad_status = (shm.valid & FP_OSD_SHM_VALID_GAMEPAD) ? (int32_t)(shm.gamepad_status & 0x7FFFFFFF) : -1;
+    sampler_data.custom_valid = 0;
+    for (int i=0; i<fp_osd_shm_custom_count; i++){
+        if (!(shm.valid & FP_OSD_SHM_VALID_CUSTOM(i))){continue;}
+        sampler_data.custom_valid |= FP_OSD_SHM_VALID_CUSTOM(i); sampler_data.custom[i] = shm.custom[i];
+        memcpy(sampler_data.custom_label[i], shm.custom_label[i], fp_osd_shm_label_size);
+    }
+}
+#endif
 
 //osd related
 #ifndef NO_OSD
-static void osd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_ELEMENT_HANDLE_T *element, DISPMANX_UPDATE_HANDLE_T update, uint32_t osd_width, uint32_t osd_height, uint32_t x, uint32_t y, uint32_t width, uint32_t height){
+static void osd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_ELEMENT_HANDLE_T *element, DISPMANX_UPDATE_HANDLE_T *update, uint32_t osd_width, uint32_t osd_height, uint32_t x, uint32_t y, uint32_t width, uint32_t height){
     if (osd_buffer_ptr == NULL){
         osd_buffer_ptr = calloc(1, osd_width * osd_height * 4);
         if (osd_buffer_ptr != NULL){
@@ -419,51 +1319,26 @@ static void osd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_ELEM
     }
 
     if (osd_buffer_ptr != NULL){ //valid bitmap buffer
-        char buffer[256] = {'\0'}; FILE *filehandle;
+        char buffer[256] = {'\0'};
         uint32_t text_column = osd_text_padding, text_y = osd_text_padding;
         bool draw_update = false;
 
-        //system: cpu load data before time to limit displayed time stuttering
-        int32_t cpu_load = 0; static double cpu_load_add = 0; static uint32_t cpu_loops = 0;
-        filehandle = fopen("/proc/stat", "r");
-        if (filehandle != NULL){
-            uint64_t a0=0, a1=0, a2=0, a3=0, b0=1, b1=0, b2=0, b3=0; //b0=1 to avoid div/0 if failed
-            fscanf(filehandle, "%*s %llu %llu %llu %llu", &a0, &a1, &a2, &a3); usleep(200000); rewind(filehandle);
-            fscanf(filehandle, "%*s %llu %llu %llu %llu", &b0, &b1, &b2, &b3); fclose(filehandle);
-            double cpu_load_tmp = (double)((b0-a0)+(b1-a1)+(b2-a2)) / ((b0-a0)+(b1-a1)+(b2-a2)+(b3-a3)) * 100;
-            if (cpu_load_tmp < 0.){cpu_load_tmp = 0.;} else if (cpu_load_tmp > 100.){cpu_load_tmp = 100.;}
-            cpu_load_add += cpu_load_tmp; cpu_loops++;
-        }
-
         //rtc/ntc/uptime data
-        static uint32_t uptime_value_prev = UINT32_MAX; //redraw when seconds changes
-        static bool time_rtc = false, time_ntc = false;
-
-        if (!time_rtc && access(rtc_path, F_OK) == 0){time_rtc = true; //rtc check
-        } else if (!time_ntc && access("/usr/bin/timedatectl", F_OK) == 0){ //ntc check
-            filehandle = popen("timedatectl timesync-status", "r");
-            if(filehandle != NULL){
-                while(fgets(buffer, 255, filehandle) != NULL){
-                    if (strstr(buffer, "Packet count") != NULL){uint32_t tmp = 0; sscanf(buffer, "%*[^0123456789]%d", &tmp); time_ntc = (tmp > 0); break;}
-                }
-                pclose(filehandle);
-            }
-        }
-
-        if (time_rtc || time_ntc){
+        static uint32_t uptime_value_prev = UINT32_MAX, data_version_prev = 0; //redraw when seconds or osd data snapshot changes
+        if (osd_data.version != data_version_prev || *element == 0){data_version_prev = osd_data.version; draw_update = true;}
+        if (osd_data.time_rtc || osd_data.time_ntc){
             time_t now = time(0); struct tm *ltime = localtime(&now);
-            if (ltime->tm_sec != uptime_value_prev){
+            if (ltime->tm_sec != uptime_value_prev){uptime_value_prev = ltime->tm_sec; draw_update = true;}
+            if (draw_update){
                 char buffer0[128]; strftime(buffer0, 127, "%X %x", ltime);
-                sprintf(buffer, "%s: %s", time_rtc?"RTC":"NTC", buffer0);
-                uptime_value_prev = ltime->tm_sec; draw_update = true;
+                sprintf(buffer, "%s: %s", osd_data.time_rtc?"RTC":"NTC", buffer0);
             }
         } else { //fall back on uptime
-            uint32_t uptime_value = 0;
-            filehandle = fopen("/proc/uptime","r"); if (filehandle != NULL){fscanf(filehandle, "%u", &uptime_value);fclose(filehandle);}
-            if (uptime_value != uptime_value_prev){
+            uint32_t uptime_value = uptime_get();
+            if (uptime_value != uptime_value_prev){uptime_value_prev = uptime_value; draw_update = true;}
+            if (draw_update){
                 uint32_t uptime_h = uptime_value/3600; uint16_t uptime_m = (uptime_value-(uptime_h*3600))/60; uint8_t uptime_s = uptime_value-(uptime_h*3600)-(uptime_m*60);
                 sprintf(buffer, "Uptime: %02u:%02u:%02u", uptime_h, uptime_m, uptime_s);
-                uptime_value_prev = uptime_value; draw_update = true;
             }
         }
 
@@ -475,9 +1350,7 @@ static void osd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_ELEM
             text_y += osd_text_padding + RASPIDMX_FONT_HEIGHT;
 
             //battery gauge
-            double batt_voltage = -1.;
-            //filehandle = fopen(battery_rsoc_path, "r"); if (filehandle != NULL){fscanf(filehandle, "%d", &batt_rsoc); fclose(filehandle);} //rsoc
-            filehandle = fopen(battery_volt_path, "r"); if (filehandle != NULL){fscanf(filehandle, "%lf", &batt_voltage); fclose(filehandle); batt_voltage /= battery_volt_divider;} //voltage
+            double batt_voltage = osd_data.battery_voltage;
             if (battery_rsoc > -1 || batt_voltage > 0){
                 strcpy(buffer, "Battery: "); char buffer0[16] = {'\0'};
 
@@ -494,60 +1367,27 @@ static void osd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_ELEM
             }
 
             //system: memory
-            static int32_t memory_total = 0; int32_t memory_free = -1, memory_used = -1;
-            static int32_t swap_total = 0; int32_t swap_free = -1, swap_used = -1;
-            filehandle = fopen("/proc/meminfo", "r");
-            if (filehandle != NULL){
-                int32_t mem_free = -1, mem_buffers = -1, mem_chached = -1;
-                while (fgets (buffer, 255, filehandle) != NULL){
-                    if (memory_total == 0 && strstr(buffer, "MemTotal") != NULL){sscanf(buffer, "%*[^0123456789]%d", &memory_total); memory_total /= memory_divider;}
-                    if (mem_free == -1 && strstr(buffer, "MemFree") != NULL){sscanf(buffer, "%*[^0123456789]%d", &mem_free);}
-                    if (mem_buffers == -1 && strstr(buffer, "Buffers") != NULL){sscanf(buffer, "%*[^0123456789]%d", &mem_buffers);}
-                    if (mem_chached == -1 && strstr(buffer, "Cached") != NULL){sscanf(buffer, "%*[^0123456789]%d", &mem_chached);}
-                    if (swap_total == 0 && strstr(buffer, "SwapTotal") != NULL){sscanf(buffer, "%*[^0123456789]%d", &swap_total); swap_total /= memory_divider;}
-                    if (swap_free == -1 && strstr(buffer, "SwapFree") != NULL){sscanf(buffer, "%*[^0123456789]%d", &swap_free); swap_free /= memory_divider;}
-                    if (memory_total != 0 && mem_free != -1 && mem_buffers != -1 && mem_chached != -1 && swap_free != -1){break;}
-                }
-                fclose(filehandle);
-                memory_free = (mem_free + mem_buffers + mem_chached) / memory_divider;
-                memory_used = memory_total - memory_free;
-                swap_used = swap_total - swap_free;
-            }
+            int32_t memory_total = osd_data.memory_total, memory_used = osd_data.memory_used;
+            int32_t swap_total = osd_data.swap_total, swap_used = osd_data.swap_used;
 
             //system: gpu memory
-            static int32_t gpu_memory_total = 0;
-            int32_t gpu_memory_free = -1, gpu_memory_used = -1;
-            {
-                static char* gpu_mem_cmd[4] = {"malloc_total", "reloc_total", "malloc", "reloc"}; int32_t memory[4] = {0};
-                for (int i=0; i<4; i++){
-                    if (gpu_mem_cmd[i] != NULL && vc_gencmd(buffer, 255, "get_mem %s", gpu_mem_cmd[i]) == 0){
-                        if (strstr(buffer, gpu_mem_cmd[i]) != NULL){sscanf(buffer, "%*[^0123456789]%d", &memory[i]);}
-                    }
-                }
+            int32_t gpu_memory_total = osd_data.gpu_memory_total, gpu_memory_used = osd_data.gpu_memory_used;
 
-                if (gpu_memory_total == 0 && memory[0] + memory[1] > 0){ //total: malloc_total + reloc_total
-                    gpu_memory_total = memory[0] + memory[1];
-                    gpu_mem_cmd[0] = gpu_mem_cmd[1] = NULL; //no need to recheck total once done
-                }
-                
-                if (gpu_memory_total > 0){
-                    gpu_memory_free = memory[2] + memory[3]; //free: malloc + reloc
-                    gpu_memory_used = gpu_memory_total - gpu_memory_free;
-                }
-            }
+            //system: undervoltage and throttling
+            int32_t throttled = osd_data.throttled;
 
             //system display
-            cpu_load = (int32_t)(cpu_load_add / cpu_loops); cpu_load_add = cpu_loops = 0;
-            if (cputemp_curr > -1 || cpu_load > -1 || memory_total > -1 || gpu_memory_total > -1){
+            if (cputemp_curr > -1 || osd_data.cpu_load > -1 || memory_total > -1 || gpu_memory_total > -1 || throttled > 0){
                 raspidmx_drawStringRGBA32(osd_buffer_ptr, osd_width, osd_height, text_column, text_y, "System:", raspidmx_font_ptr, osd_color_text, &osd_color_text_bg);
                 text_column = osd_text_padding * 2 + RASPIDMX_FONT_WIDTH * 7;
 
-                if (cputemp_curr > -1 || cpu_load > -1){
+                if (cputemp_curr > -1 || osd_data.cpu_load > -1){
                     uint32_t tmp_color = osd_color_text;
                     if (cputemp_curr > -1){
                         if (cputemp_curr >= cputemp_crit){tmp_color = osd_color_crit;} else if (cputemp_curr >= cputemp_warn){tmp_color = osd_color_warn;}
-                        sprintf(buffer, "CPU: %d%c%c (%d%% load)", cputemp_disp, (char)248, cputemp_celsius?'C':'F', cpu_load);
-                    } else {sprintf(buffer, "CPU: %d%%", cpu_load);}
+                        if (osd_data.cpu_load > -1){sprintf(buffer, "CPU: %d%c%c (%d%% load)", cputemp_disp, (char)248, cputemp_celsius?'C':'F', osd_data.cpu_load);
+                        } else {sprintf(buffer, "CPU: %d%c%c", cputemp_disp, (char)248, cputemp_celsius?'C':'F');} //load not sampled yet
+                    } else {sprintf(buffer, "CPU: %d%%", osd_data.cpu_load);}
                     raspidmx_drawStringRGBA32(osd_buffer_ptr, osd_width, osd_height, text_column, text_y, buffer, raspidmx_font_ptr, tmp_color, &osd_color_text_bg);
                     text_y += RASPIDMX_FONT_HEIGHT;
                 }
@@ -581,67 +1421,51 @@ static void osd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_ELEM
                     text_y += RASPIDMX_FONT_HEIGHT;
                 }
 
+                //undervoltage and throttling, current state in bits 0-3, occurred since boot in bits 16-19
+                if (throttled > 0){
+                    bool throttled_now = throttled & 0xF;
+                    int32_t flags = throttled_now ? throttled : throttled >> 16;
+                    sprintf(buffer, "%s:%s%s%s%s", throttled_now ? "Throttled" : "Throttled (past)", (flags & 0x1)?" undervolt":"", (flags & 0x2)?" freq capped":"", (flags & 0x4)?" throttled":"", (flags & 0x8)?" temp limit":"");
+                    raspidmx_drawStringRGBA32(osd_buffer_ptr, osd_width, osd_height, text_column, text_y, buffer, raspidmx_font_ptr, throttled_now?osd_color_crit:osd_color_warn, &osd_color_text_bg);
+                    text_y += RASPIDMX_FONT_HEIGHT;
+                }
+
                 text_y += osd_text_padding; text_column = osd_text_padding;
             }
 
             //backlight
-            int32_t backlight = -1, backlight_max = -1;
-            filehandle = fopen(backlight_path, "r"); if (filehandle != NULL){fscanf(filehandle, "%d", &backlight); fclose(filehandle);}
-            filehandle = fopen(backlight_max_path, "r"); if (filehandle != NULL){fscanf(filehandle, "%d", &backlight_max); fclose(filehandle);}
+            int32_t backlight = osd_data.backlight, backlight_max = osd_data.backlight_max;
             if (backlight > -1){
                 sprintf(buffer, "Backlight: %d", backlight);
-                if (backlight_max > -1){char buffer0[11]; sprintf(buffer0, "/%d", backlight_max); strcat(buffer, buffer0);}
+                if (backlight_max > -1){char buffer0[13]; sprintf(buffer0, "/%d", backlight_max); strcat(buffer, buffer0);} //'/' + int32 incl. sign + null char
                 raspidmx_drawStringRGBA32(osd_buffer_ptr, osd_width, osd_height, text_column, text_y, buffer, raspidmx_font_ptr, osd_color_text, &osd_color_text_bg);
                 text_y += osd_text_padding + RASPIDMX_FONT_HEIGHT;
             }
 
-            //network
-            #define network_data_limit 10
-            typedef struct {
-                uint8_t count;
-                struct osd_if_struct {char name[IF_NAMESIZE]; char ipv4[16]; /*char ipv6[40];*/ int speed, signal; bool up;} interface[network_data_limit];
-            } osd_network_data_t;
-            osd_network_data_t osd_network_data = {0};
-
-            struct ifaddrs *ifap, *ifa;
-            if (getifaddrs(&ifap) == 0){
-                for (ifa = ifap; ifa; ifa = ifa->ifa_next){
-                    if (!(ifa->ifa_flags & IFF_LOOPBACK) && ifa->ifa_addr->sa_family == AF_INET && ifa->ifa_addr){
-                        char* ip = inet_ntoa(((struct sockaddr_in *) ifa->ifa_addr)->sin_addr);
-                        struct osd_if_struct *ptr = &osd_network_data.interface[osd_network_data.count];
-                        strncpy(ptr->name, ifa->ifa_name, IF_NAMESIZE-1);
-                        strncpy(ptr->ipv4, ip, 15);
-                        ptr->up = ifa->ifa_flags & IFF_UP;
-                        osd_network_data.count++;
-                        if (osd_network_data.count > network_data_limit){break;}
-                    }
-                }
+            //shared memory metrics: gamepad status and custom values
+            int32_t gamepad_status = osd_data.gamepad_status;
+            if (gamepad_status > -1){
+                bool gamepad_error = gamepad_status & FP_OSD_SHM_GAMEPAD_ERROR;
+                sprintf(buffer, "Gamepad: %s", gamepad_error ? "Error" : ((gamepad_status & FP_OSD_SHM_GAMEPAD_CONNECTED) ? "Connected" : "Disconnected"));
+                raspidmx_drawStringRGBA32(osd_buffer_ptr, osd_width, osd_height, text_column, text_y, buffer, raspidmx_font_ptr, gamepad_error ? osd_color_crit : osd_color_text, &osd_color_text_bg);
+                text_y += RASPIDMX_FONT_HEIGHT;
             }
-            freeifaddrs(ifap);
-
-            //wifi link speed and signal
-            if (access("/sbin/iw", F_OK) == 0){
-                for (int i=0; i<osd_network_data.count; i++){
-                    int* tmp_speed = &osd_network_data.interface[i].speed;
-                    int* tmp_signal = &osd_network_data.interface[i].signal;
-                    sprintf(buffer, "iw dev %s link 2> /dev/null", osd_network_data.interface[i].name); //build commandline
-                    filehandle = popen(buffer, "r");
-                    if(filehandle != NULL){
-                        while(fgets(buffer, 255, filehandle) != NULL){
-                            if(*tmp_signal == 0 && strstr(buffer, "signal") != NULL){sscanf(buffer, "%*[^0123456789]%d", tmp_signal); //signal
-                            }else if(*tmp_speed == 0 && strstr(buffer, "bitrate") != NULL){sscanf(buffer, "%*[^0123456789]%d", tmp_speed);} //speed
-                            if (*tmp_signal != 0 && *tmp_speed != 0){break;}
-                        }
-                        pclose(filehandle);
-                    }
-                }
+            for (int i=0; i<fp_osd_shm_custom_count; i++){
+                if (!(osd_data.custom_valid & FP_OSD_SHM_VALID_CUSTOM(i))){continue;}
+                sprintf(buffer, "%s: %d", osd_data.custom_label[i], osd_data.custom[i]);
+                raspidmx_drawStringRGBA32(osd_buffer_ptr, osd_width, osd_height, text_column, text_y, buffer, raspidmx_font_ptr, osd_color_text, &osd_color_text_bg);
+                text_y += RASPIDMX_FONT_HEIGHT;
             }
+            if (gamepad_status > -1 || osd_data.custom_valid){text_y += osd_text_padding;}
+
+            //network
+            osd_network_data_t *osd_network_data = &osd_data.network;
 
-            if (osd_network_data.count){
+            if (osd_network_data->count){
                 raspidmx_drawStringRGBA32(osd_buffer_ptr, osd_width, osd_height, text_column, text_y, "Network:", raspidmx_font_ptr, osd_color_text, &osd_color_text_bg);
                 text_column = osd_text_padding * 2 + RASPIDMX_FONT_WIDTH * 8;
-                for (int i=0; i<osd_network_data.count; i++){
-                    struct osd_if_struct *ptr = &osd_network_data.interface[i];
+                for (int i=0; i<osd_network_data->count; i++){
+                    struct osd_if_struct *ptr = &osd_network_data->interface[i];
                     sprintf(buffer, "%s: %s", ptr->name, (ptr->ipv4[0]!='\0') ? ptr->ipv4 : "Unknown");
                     raspidmx_drawStringRGBA32(osd_buffer_ptr, osd_width, osd_height, text_column, text_y, buffer, raspidmx_font_ptr, osd_color_text, &osd_color_text_bg);
                     text_y += RASPIDMX_FONT_HEIGHT;
@@ -672,11 +1496,11 @@ static void osd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_ELEM
                 vc_dispmanx_rect_set(&osd_rect, 0, 0, osd_width << 16, osd_height << 16);
                 VC_RECT_T osd_rect_dest; vc_dispmanx_rect_set(&osd_rect_dest, x, y, width, height);
                 if (*element == 0){
-                    *element = vc_dispmanx_element_add(update, dispmanx_display, osd_layer + 1, &osd_rect_dest, resource, &osd_rect, DISPMANX_PROTECTION_NONE, &dispmanx_alpha_from_src, NULL, DISPMANX_NO_ROTATE);
+                    *element = vc_dispmanx_element_add(dispmanx_update_get(update), dispmanx_display, osd_layer + 1, &osd_rect_dest, resource, &osd_rect, DISPMANX_PROTECTION_NONE, &dispmanx_alpha_from_src, NULL, DISPMANX_NO_ROTATE);
                     if (debug && *element == 0){print_stderr("failed to add element.\n");}
                 } else {
-                    vc_dispmanx_element_modified(update, *element, &osd_rect_dest);
-                    vc_dispmanx_element_change_attributes(update, *element, 0, 0, 0, &osd_rect_dest, 0, 0, DISPMANX_NO_ROTATE);
+                    vc_dispmanx_element_modified(dispmanx_update_get(update), *element, &osd_rect_dest);
+                    vc_dispmanx_element_change_attributes(dispmanx_update_get(update), *element, 0, 0, 0, &osd_rect_dest, 0, 0, DISPMANX_NO_ROTATE);
                 }
             }
         }
@@ -685,7 +1509,7 @@ static void osd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_ELEM
 #endif
 
 #ifndef NO_TINYOSD
-static void tinyosd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_ELEMENT_HANDLE_T *element, DISPMANX_UPDATE_HANDLE_T update, uint32_t osd_width, uint32_t osd_height, uint32_t x, uint32_t y, uint32_t width, uint32_t height){
+static void tinyosd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_ELEMENT_HANDLE_T *element, DISPMANX_UPDATE_HANDLE_T *update, uint32_t osd_width, uint32_t osd_height, uint32_t x, uint32_t y, uint32_t width, uint32_t height){
     if (tinyosd_buffer_ptr == NULL){
         tinyosd_buffer_ptr = calloc(1, osd_width * osd_height * 4);
         if (tinyosd_buffer_ptr != NULL){
@@ -695,49 +1519,23 @@ static void tinyosd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_
     }
 
     if (tinyosd_buffer_ptr != NULL){ //valid bitmap buffer
-        char buffer[256] = {'\0'}; FILE *filehandle;
+        char buffer[256] = {'\0'};
         bool draw_update = false;
         uint32_t text_column_left = 0, text_column_right = osd_width;
 
-        //system: cpu load data before time to limit displayed time stuttering
-        int32_t cpu_load = 0; static double cpu_load_add = 0; static uint32_t cpu_loops = 0;
-        filehandle = fopen("/proc/stat", "r");
-        if (filehandle != NULL){
-            uint64_t a0=0, a1=0, a2=0, a3=0, b0=1, b1=0, b2=0, b3=0; //b0=1 to avoid div/0 if failed
-            fscanf(filehandle, "%*s %llu %llu %llu %llu", &a0, &a1, &a2, &a3); usleep(200000); rewind(filehandle);
-            fscanf(filehandle, "%*s %llu %llu %llu %llu", &b0, &b1, &b2, &b3); fclose(filehandle);
-            double cpu_load_tmp = (double)((b0-a0)+(b1-a1)+(b2-a2)) / ((b0-a0)+(b1-a1)+(b2-a2)+(b3-a3)) * 100;
-            if (cpu_load_tmp < 0.){cpu_load_tmp = 0.;} else if (cpu_load_tmp > 100.){cpu_load_tmp = 100.;}
-            cpu_load_add += cpu_load_tmp; cpu_loops++;
-        }
-
         //rtc/ntc/uptime data
-        static uint32_t uptime_value_prev = UINT32_MAX; //redraw when seconds changes
-        static bool time_rtc = false, time_ntc = false;
-        if (!time_rtc && access(rtc_path, F_OK) == 0){time_rtc = true; //rtc check
-        } else if (!time_ntc && access("/usr/bin/timedatectl", F_OK) == 0){ //ntc check
-            filehandle = popen("timedatectl timesync-status", "r");
-            if(filehandle != NULL){
-                while(fgets(buffer, 255, filehandle) != NULL){
-                    if (strstr(buffer, "Packet count") != NULL){uint32_t tmp = 0; sscanf(buffer, "%*[^0123456789]%d", &tmp); time_ntc = (tmp > 0); break;}
-                }
-                pclose(filehandle);
-            }
-        }
-
-        if (time_rtc || time_ntc){
+        static uint32_t uptime_value_prev = UINT32_MAX, data_version_prev = 0; //redraw when seconds or osd data snapshot changes
+        if (osd_data.version != data_version_prev || *element == 0){data_version_prev = osd_data.version; draw_update = true;}
+        if (osd_data.time_rtc || osd_data.time_ntc){
             time_t now = time(0); struct tm *ltime = localtime(&now);
-            if (ltime->tm_sec != uptime_value_prev){
-                strftime(buffer, 255, "%X", ltime);
-                uptime_value_prev = ltime->tm_sec; draw_update = true;
-            }
+            if (ltime->tm_sec != uptime_value_prev){uptime_value_prev = ltime->tm_sec; draw_update = true;}
+            if (draw_update){strftime(buffer, 255, "%X", ltime);}
         } else { //fall back on uptime
-            uint32_t uptime_value = 0;
-            filehandle = fopen("/proc/uptime","r"); if (filehandle != NULL){fscanf(filehandle, "%u", &uptime_value);fclose(filehandle);}
-            if (uptime_value != uptime_value_prev){
+            uint32_t uptime_value = uptime_get();
+            if (uptime_value != uptime_value_prev){uptime_value_prev = uptime_value; draw_update = true;}
+            if (draw_update){
                 uint32_t uptime_h = uptime_value/3600; uint16_t uptime_m = (uptime_value-(uptime_h*3600))/60; uint8_t uptime_s = uptime_value-(uptime_h*3600)-(uptime_m*60);
                 sprintf(buffer, "%02u:%02u:%02u", uptime_h, uptime_m, uptime_s);
-                uptime_value_prev = uptime_value; draw_update = true;
             }
         }
 
@@ -751,9 +1549,7 @@ static void tinyosd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_
             raspidmx_drawCharRGBA32(tinyosd_buffer_ptr, osd_width, osd_height, text_column_right, 0, 1, osd_icon_font_ptr, osd_color_separator/*, NULL*/); //separator
 
             //battery: left side
-            double batt_voltage = -1.;
-            //filehandle = fopen(battery_rsoc_path, "r"); if (filehandle != NULL){fscanf(filehandle, "%d", &battery_rsoc); fclose(filehandle);} //rsoc
-            filehandle = fopen(battery_volt_path, "r"); if (filehandle != NULL){fscanf(filehandle, "%lf", &batt_voltage); fclose(filehandle); batt_voltage /= battery_volt_divider;} //voltage
+            double batt_voltage = osd_data.battery_voltage;
             //batt_rsoc = 100; batt_voltage = 4.195;
             if (battery_rsoc > -1 || batt_voltage > 0){
                 uint32_t tmp_color = osd_color_text;
@@ -772,13 +1568,13 @@ static void tinyosd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_
             //cpu: left side
             //int32_t cpu_temp = -1;
             //filehandle = fopen(cpu_thermal_path, "r"); if (filehandle != NULL){fscanf(filehandle, "%d", &cpu_temp); fclose(filehandle); cpu_temp /= cpu_thermal_divider;} //temp
-            cpu_load = (int32_t)(cpu_load_add / cpu_loops); cpu_load_add = cpu_loops = 0; //load
-            if (cputemp_curr > -1 || cpu_load > -1){
+            if (cputemp_curr > -1 || osd_data.cpu_load > -1){
                 uint32_t tmp_color = osd_color_text;
                 if (cputemp_curr > -1){
                     if (cputemp_curr >= cputemp_crit){tmp_color = osd_color_crit;} else if (cputemp_curr >= cputemp_warn){tmp_color = osd_color_warn;}
-                    sprintf(buffer, "%d%c%c %3d%%", cputemp_disp, (char)248, cputemp_celsius?'C':'F', cpu_load);
-                } else {sprintf(buffer, "%3d%%", cpu_load);}
+                    if (osd_data.cpu_load > -1){sprintf(buffer, "%d%c%c %3d%%", cputemp_disp, (char)248, cputemp_celsius?'C':'F', osd_data.cpu_load);
+                    } else {sprintf(buffer, "%d%c%c", cputemp_disp, (char)248, cputemp_celsius?'C':'F');} //load not sampled yet
+                } else {sprintf(buffer, "%3d%%", osd_data.cpu_load);}
 
                 text_column_left = raspidmx_drawCharRGBA32(tinyosd_buffer_ptr, osd_width, osd_height, text_column_left, 0, 2, osd_icon_font_ptr, tmp_color/*, NULL*/) + 2; //cpu icon
                 text_column_left = raspidmx_drawStringRGBA32(tinyosd_buffer_ptr, osd_width, osd_height, text_column_left, 0, buffer, raspidmx_font_ptr, tmp_color, NULL).x;
@@ -786,9 +1582,7 @@ static void tinyosd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_
             }
 
             //backlight: right side
-            int32_t backlight = -1, backlight_max = -1;
-            filehandle = fopen(backlight_path, "r"); if (filehandle != NULL){fscanf(filehandle, "%d", &backlight); fclose(filehandle);}
-            filehandle = fopen(backlight_max_path, "r"); if (filehandle != NULL){fscanf(filehandle, "%d", &backlight_max); fclose(filehandle);}
+            int32_t backlight = osd_data.backlight, backlight_max = osd_data.backlight_max;
             if (backlight > -1){
                 if (backlight_max < 1){sprintf(buffer, "%d", backlight);
                 } else {sprintf(buffer, "%.0lf%%", ((double)backlight/backlight_max)*100);}
@@ -802,29 +1596,12 @@ static void tinyosd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_
             }
 
             //wifi:right side
-            
-            if (access("/sbin/iw", F_OK) == 0){
+            {
                 int32_t wifi_speed = 0, wifi_signal = 0;
-                struct ifaddrs *ifap, *ifa;
-                if (getifaddrs(&ifap) == 0){
-                    for (ifa = ifap; ifa; ifa = ifa->ifa_next){
-                        if (!(ifa->ifa_flags & IFF_LOOPBACK) && ifa->ifa_addr->sa_family == AF_INET && ifa->ifa_addr){
-                            sprintf(buffer, "iw dev %s link 2> /dev/null", ifa->ifa_name); //build commandline
-                            filehandle = popen(buffer, "r");
-                            if(filehandle != NULL){
-                                while(fgets(buffer, 255, filehandle) != NULL){
-                                    if(wifi_signal == 0 && strstr(buffer, "signal") != NULL){sscanf(buffer, "%*[^0123456789]%d", &wifi_signal); //signal
-                                    }else if(wifi_speed == 0 && strstr(buffer, "bitrate") != NULL){sscanf(buffer, "%*[^0123456789]%d", &wifi_speed);} //speed
-                                    if (wifi_signal != 0 && wifi_speed != 0){break;}
-                                }
-                                pclose(filehandle);
-                            }
-                            if (wifi_speed != 0){break;}
-                        }
-                    }
+                for (int i=0; i<osd_data.network.count; i++){ //first interface with link speed
+                    if (osd_data.network.interface[i].speed != 0){wifi_speed = osd_data.network.interface[i].speed; wifi_signal = osd_data.network.interface[i].signal; break;}
                 }
-                freeifaddrs(ifap);
-            
+
                 if (wifi_speed > 0){
                     const int32_t wifi_signal_steps[2] = {30,60}, wifi_speed_steps[2] = {5,38}; //critical, warn limits
                     uint32_t tmp_color = osd_color_text;
@@ -865,11 +1642,11 @@ static void tinyosd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_
                 vc_dispmanx_rect_set(&osd_rect, 0, 0, osd_width << 16, osd_height << 16);
                 VC_RECT_T osd_rect_dest; vc_dispmanx_rect_set(&osd_rect_dest, x, y, width, height);
                 if (*element == 0){
-                    *element = vc_dispmanx_element_add(update, dispmanx_display, osd_layer + 3, &osd_rect_dest, resource, &osd_rect, DISPMANX_PROTECTION_NONE, &dispmanx_alpha_from_src, NULL, DISPMANX_NO_ROTATE);
+                    *element = vc_dispmanx_element_add(dispmanx_update_get(update), dispmanx_display, osd_layer + 3, &osd_rect_dest, resource, &osd_rect, DISPMANX_PROTECTION_NONE, &dispmanx_alpha_from_src, NULL, DISPMANX_NO_ROTATE);
                     if (debug && *element == 0){print_stderr("failed to add element.\n");}
                 } else {
-                    vc_dispmanx_element_modified(update, *element, &osd_rect_dest);
-                    vc_dispmanx_element_change_attributes(update, *element, 0, 0, 0, &osd_rect_dest, 0, 0, DISPMANX_NO_ROTATE);
+                    vc_dispmanx_element_modified(dispmanx_update_get(update), *element, &osd_rect_dest);
+                    vc_dispmanx_element_change_attributes(dispmanx_update_get(update), *element, 0, 0, 0, &osd_rect_dest, 0, 0, DISPMANX_NO_ROTATE);
                 }
             }
         }
@@ -878,7 +1655,7 @@ static void tinyosd_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_
 #endif
 
 #ifndef NO_BATTERY_ICON
-static void lowbatt_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_ELEMENT_HANDLE_T *element, DISPMANX_UPDATE_HANDLE_T update, uint32_t icon_width, uint32_t icon_height, uint32_t x, uint32_t y, uint32_t width, uint32_t height){
+static void lowbatt_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_ELEMENT_HANDLE_T *element, DISPMANX_UPDATE_HANDLE_T *update, uint32_t icon_width, uint32_t icon_height, uint32_t x, uint32_t y, uint32_t width, uint32_t height){
     uint32_t icon_width_16 = ALIGN_TO_16(icon_width), icon_height_16 = ALIGN_TO_16(icon_height);
 
     if (lowbat_buffer_ptr == NULL){
@@ -916,11 +1693,11 @@ static void lowbatt_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_
                 vc_dispmanx_rect_set(&icon_rect, 0, 0, icon_width << 16, icon_height << 16);
                 VC_RECT_T icon_rect_dest; vc_dispmanx_rect_set(&icon_rect_dest, x, y, width, height);
                 if (*element == 0){
-                    *element = vc_dispmanx_element_add(update, dispmanx_display, osd_layer + 2, &icon_rect_dest, resource, &icon_rect, DISPMANX_PROTECTION_NONE, &dispmanx_alpha_from_src, NULL, DISPMANX_NO_ROTATE);
+                    *element = vc_dispmanx_element_add(dispmanx_update_get(update), dispmanx_display, osd_layer + 2, &icon_rect_dest, resource, &icon_rect, DISPMANX_PROTECTION_NONE, &dispmanx_alpha_from_src, NULL, DISPMANX_NO_ROTATE);
                     if (debug && *element == 0){print_stderr("failed to add element.\n");}
                 } else {
-                    vc_dispmanx_element_modified(update, *element, &icon_rect_dest);
-                    vc_dispmanx_element_change_attributes(update, *element, 0, 0, 0, &icon_rect_dest, 0, 0, DISPMANX_NO_ROTATE);
+                    vc_dispmanx_element_modified(dispmanx_update_get(update), *element, &icon_rect_dest);
+                    vc_dispmanx_element_change_attributes(dispmanx_update_get(update), *element, 0, 0, 0, &icon_rect_dest, 0, 0, DISPMANX_NO_ROTATE);
                 }
             }
             y_back = y;
@@ -930,7 +1707,7 @@ static void lowbatt_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_
 #endif
 
 #ifndef NO_CPU_ICON
-static void cputemp_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_ELEMENT_HANDLE_T *element, DISPMANX_UPDATE_HANDLE_T update, uint32_t icon_width, uint32_t icon_height, uint32_t x, uint32_t y, uint32_t width, uint32_t height){
+static void cputemp_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_ELEMENT_HANDLE_T *element, DISPMANX_UPDATE_HANDLE_T *update, uint32_t icon_width, uint32_t icon_height, uint32_t x, uint32_t y, uint32_t width, uint32_t height){
     uint32_t icon_width_16 = ALIGN_TO_16(icon_width), icon_height_16 = ALIGN_TO_16(icon_height);
 
     if (cputemp_buffer_ptr == NULL){
@@ -965,241 +1742,398 @@ static void cputemp_build_element(DISPMANX_RESOURCE_HANDLE_T resource, DISPMANX_
                 vc_dispmanx_rect_set(&icon_rect, 0, 0, icon_width << 16, icon_height << 16);
                 VC_RECT_T icon_rect_dest; vc_dispmanx_rect_set(&icon_rect_dest, x, y, width, height);
                 if (*element == 0){
-                    *element = vc_dispmanx_element_add(update, dispmanx_display, osd_layer + 2, &icon_rect_dest, resource, &icon_rect, DISPMANX_PROTECTION_NONE, &dispmanx_alpha_from_src, NULL, DISPMANX_NO_ROTATE);
+                    *element = vc_dispmanx_element_add(dispmanx_update_get(update), dispmanx_display, osd_layer + 2, &icon_rect_dest, resource, &icon_rect, DISPMANX_PROTECTION_NONE, &dispmanx_alpha_from_src, NULL, DISPMANX_NO_ROTATE);
                     if (debug && *element == 0){print_stderr("failed to add element.\n");}
                 } else {
-                    vc_dispmanx_element_modified(update, *element, &icon_rect_dest);
-                    vc_dispmanx_element_change_attributes(update, *element, 0, 0, 0, &icon_rect_dest, 0, 0, DISPMANX_NO_ROTATE);
+                    vc_dispmanx_element_modified(dispmanx_update_get(update), *element, &icon_rect_dest);
+                    vc_dispmanx_element_change_attributes(dispmanx_update_get(update), *element, 0, 0, 0, &icon_rect_dest, 0, 0, DISPMANX_NO_ROTATE);
                 }
             }
             y_back = y;
         }
     } else if (debug){print_stderr("calloc failed.\n");} //failed to allocate buffer
 }
-#endif
+#endif
+
+//integer manipulation functs
+static int int_constrain(int* val, int min, int max){ //limit int value to given (incl) min and max value, return 0 if val within min and max, -1 under min, 1 over max
+    int ret = 0;
+    if (*val < min){*val = min; ret = -1;} else if (*val > max){*val = max; ret = 1;}
+    return ret;
+}
+
+
+//evdev functs
+#ifndef NO_EVDEV
+static int evdev_combos_parse(char* sequences_char, uint8_t action){ //parse trigger sequences separated by ';' character, keycodes separated by '+' (held simultaneously) or ',' (pressed within detection interval), int or hex values, return sequences count
+    if (sequences_char[0] == '-'){sequences_char[0] = '\0';} //assume '-' char as first char as -1
+    int count = 0;
+    char buffer[strlen(sequences_char) + 1]; strcpy(buffer, sequences_char);
+    char *sequence_save, *key_save;
+    for (char *sequence = strtok_r(buffer, ";", &sequence_save); sequence != NULL; sequence = strtok_r(NULL, ";", &sequence_save)){
+        if (evdev_combos_count == evdev_combos_max){print_stderr("Trigger sequences limit reached, '%s' ignored\n", sequence); break;}
+        evdev_combo_t *combo = &evdev_combos[evdev_combos_count];
+        memset(combo, 0, sizeof(evdev_combo_t));
+        combo->action = action; combo->held = strchr(sequence, ',') == NULL; combo->armed = true; //single key sequence is held
+        combo->word_first = evdev_key_longs; combo->word_last = -1;
+        if (!combo->held && strchr(sequence, '+') != NULL){print_stderr("'%s' mixes '+' and ',' separators, ignored\n", sequence); continue;}
+        for (char *key = strtok_r(sequence, "+,", &key_save); key != NULL; key = strtok_r(NULL, "+,", &key_save)){
+            int code = -1;
+            if (strchr(key, 'x') == NULL){code = atoi(key);} else {sscanf(key, " 0x%X", &code);} //int or hex value
+            if (code <= 0 || code > KEY_MAX){continue;}
+            int word = code / evdev_bits_per_long;
+            combo->keys[word] |= 1UL << (code % evdev_bits_per_long);
+            if (word < combo->word_first){combo->word_first = word;}
+            if (word > combo->word_last){combo->word_last = word;}
+        }
+        if (combo->word_last < 0){continue;} //no valid keycode
+
+        int keys_count = 0;
+        for (int word = combo->word_first; word <= combo->word_last; word++){
+            evdev_key_mask[word] |= combo->keys[word]; keys_count += __builtin_popcountl(combo->keys[word]);
+            for (unsigned long bits = combo->keys[word]; bits != 0; bits &= bits - 1){evdev_key_combos[word * evdev_bits_per_long + __builtin_ctzl(bits)][evdev_combos_count / evdev_bits_per_long] |= 1UL << (evdev_combos_count % evdev_bits_per_long);}
+        }
+        if (debug){print_stderr("%s sequence %d: %d key(s) %s\n", evdev_action_names[action], evdev_combos_count, keys_count, combo->held ? "held simultaneously" : "pressed within detection interval");}
+        evdev_combos_count++; count++;
+    }
+    return count;
+}
+
+static void evdev_init(void){ //parse trigger sequences and device names list, scan for input devices
+    if (evdev_path[0] == '\0'){print_stderr("Empty event device path, EVDEV disabled\n"); evdev_enabled = false; return;}
+    int evdev_path_len = strlen(evdev_path);
+    if (evdev_path_len > 1 && evdev_path[evdev_path_len - 1] == '/'){evdev_path[evdev_path_len - 1] = '\0';} //remove trailing '/' from event path
+
+    int osd_combos = 0, tinyosd_combos = 0;
+    #ifndef NO_OSD
+        osd_combos = evdev_combos_parse(osd_evdev_sequence_char, EVDEV_ACTION_OSD);
+    #endif
+    #ifndef NO_TINYOSD
+        tinyosd_combos = evdev_combos_parse(tinyosd_evdev_sequence_char, EVDEV_ACTION_TINYOSD);
+    #endif
+    evdev_combos_parse(hide_evdev_sequence_char, EVDEV_ACTION_HIDE);
+    if (osd_combos == 0 && tinyosd_combos == 0){print_stderr("No valid event sequence detected, EVDEV disabled\n"); evdev_enabled = false; return;
+    } else if (osd_combos == 0){print_stderr("OSD sequence disabled\n");
+    } else if (tinyosd_combos == 0){print_stderr("Tiny OSD sequence disabled\n");}
+
+    if (evdev_names_count == 0 && evdev_name_search[0] != '\0'){strncpy(evdev_names[evdev_names_count++], evdev_name_search, sizeof(evdev_names[0]) - 1);} //no -evdev_device argument, default name
+    if (debug){print_stderr("Searching for %d device name(s)%s\n", evdev_names_count, evdev_capability_filter ? " and devices reporting a full trigger sequence" : "");}
+    evdev_sequence_detect_interval = (double)evdev_sequence_detect_interval_ms / 1000.;
+    evdev_hotplug_init(); //before scan, device arriving meanwhile not missed
+    evdev_scan(get_time_double());
+    if (!evdev_enabled && evdev_inotify_fd != -1){loop_fd_remove(evdev_inotify_fd); close(evdev_inotify_fd); evdev_inotify_fd = -1;} //scan mode or invalid path
+}
+
+static bool evdev_hotplug_init(void){ //inotify instance watching input devices folder, return false on failure
+    char dir_path[PATH_MAX]; strncpy(dir_path, evdev_path, PATH_MAX-1); dir_path[PATH_MAX-1] = '\0';
+    struct stat evdev_stat;
+    if (stat(evdev_path, &evdev_stat) == 0 && !S_ISDIR(evdev_stat.st_mode)){ //given path is a device, watch its folder for this name only
+        char *slash = strrchr(dir_path, '/');
+        strncpy(evdev_watch_name, (slash != NULL) ? slash + 1 : dir_path, NAME_MAX);
+        if (slash == NULL){strcpy(dir_path, ".");} else if (slash == dir_path){slash[1] = '\0';} else {*slash = '\0';}
+    }
+    if ((evdev_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0 || inotify_add_watch(evdev_inotify_fd, dir_path, IN_CREATE | IN_ATTRIB | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF) < 0 || !loop_fd_add(evdev_inotify_fd, LOOP_SRC_EVDEV_HOTPLUG, 0)){
+        print_stderr("Failed to watch '%s', errno:%d, input devices rescanned every %ds while none opened.\n", dir_path, errno, evdev_check_interval);
+        if (evdev_inotify_fd >= 0){close(evdev_inotify_fd); evdev_inotify_fd = -1;}
+        return false;
+    }
+    if (debug){print_stderr("Watching '%s' for input devices arrival and removal.\n", dir_path);}
+    return true;
+}
+
+static void evdev_hotplug_process(double now){ //read inotify events, open created devices, close removed ones, periodic rescan fallback if folder gone
+    char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    bool folder_gone = false, rescan = false; ssize_t len;
+    while ((len = read(evdev_inotify_fd, buffer, sizeof(buffer))) > 0){
+        for (char *ptr = buffer; ptr < buffer + len; ptr += sizeof(struct inotify_event) + ((struct inotify_event*)ptr)->len){
+            struct inotify_event *event = (struct inotify_event*)ptr;
+            if (event->mask & IN_Q_OVERFLOW){rescan = true; continue;} //events lost
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)){folder_gone = true; continue;}
+            if (event->len == 0 || strncmp(event->name, "event", 5) != 0 || (evdev_watch_name[0] != '\0' && strcmp(event->name, evdev_watch_name) != 0)){continue;} //not an event device or not the one given
+
+            char path[PATH_MAX + NAME_MAX + 1];
+            if (evdev_watch_name[0] != '\0'){strcpy(path, evdev_path);} else {snprintf(path, sizeof(path), "%s/%s", evdev_path, event->name);}
+            if (event->mask & (IN_CREATE | IN_ATTRIB | IN_MOVED_TO)){ //new node, or its rights updated by udev after creation
+                if (evdev_device_open(path, evdev_watch_name[0] != '\0') && debug){print_stderr("'%s' hotplugged.\n", path);}
+            } else { //removed, read may not have failed yet
+                evdev_index_remove(event->name);
+                for (int i=0; i<evdev_devices_max; i++){
+                    if (evdev_devices[i].fd != -1 && strcmp(evdev_devices[i].path, path) == 0){print_stderr("'%s' (%s) removed.\n", evdev_devices[i].name, path); evdev_device_close(i);}
+                }
+            }
+        }
+    }
+    if (folder_gone){ //udev restarted or devtmpfs remounted, fallback to periodic rescan
+        print_stderr("Input devices folder gone, rescanned every %ds while no device opened.\n", evdev_check_interval);
+        loop_fd_remove(evdev_inotify_fd); close(evdev_inotify_fd); evdev_inotify_fd = -1;
+    } else if (rescan){evdev_scan(now);}
+}
+
+static int evdev_sysfs_read(const char* node, const char* attr_name, char* buffer, int size){ //read input class attribute of event device, trailing newline removed, return length or -1 on failure
+    char path[PATH_MAX]; sysfs_attr_t attr = {path, -1};
+    if (snprintf(path, PATH_MAX, "%s/%s/device/%s", evdev_sysfs_path, node, attr_name) >= PATH_MAX){return -1;}
+    int len = sysfs_attr_read(&attr, buffer, size); sysfs_attr_close(&attr); //read once per device arrival, fd not worth keeping
+    if (len > 0 && buffer[len - 1] == '\n'){buffer[--len] = '\0';}
+    return len;
+}
+
+static evdev_info_t* evdev_index_get(const char* node){ //device index entry of event device, built from sysfs on first use, NULL if not available
+    if (evdev_sysfs_path[0] == '\0'){return NULL;}
+    evdev_info_t *entry = NULL;
+    for (int i=0; i<evdev_index_max; i++){
+        if (evdev_index[i].node[0] == '\0'){if (entry == NULL){entry = &evdev_index[i];} continue;}
+        if (strcmp(evdev_index[i].node, node) == 0){return &evdev_index[i];} //already indexed
+    }
+    if (entry == NULL){return NULL;} //index full, device node opened instead
+
+    char buffer[1024];
+    memset(entry, 0, sizeof(evdev_info_t));
+    if (evdev_sysfs_read(node, "name", entry->name, sizeof(entry->name)) <= 0){return NULL;} //not an input device or sysfs not available
+    evdev_sysfs_read(node, "phys", entry->phys, sizeof(entry->phys)); //empty for virtual devices
+    if (evdev_sysfs_read(node, "id/vendor", buffer, sizeof(buffer)) > 0){entry->vendor = (uint16_t)strtoul(buffer, NULL, 16);}
+    if (evdev_sysfs_read(node, "id/product", buffer, sizeof(buffer)) > 0){entry->product = (uint16_t)strtoul(buffer, NULL, 16);}
+
+    //'capabilities/key': space separated hex words of kernel long size, most significant first
+    static int kernel_long_bits = 0;
+    if (kernel_long_bits == 0){struct utsname uts; kernel_long_bits = (uname(&uts) == 0 && strstr(uts.machine, "64") != NULL) ? 64 : 32;} //32bit userland may run on 64bit kernel
+    int len = evdev_sysfs_read(node, "capabilities/key", buffer, sizeof(buffer));
+    for (int word = 0; len > 0; word++){
+        while (len > 0 && buffer[len - 1] == ' '){len--;}
+        int start = len; while (start > 0 && buffer[start - 1] != ' '){start--;}
+        if (start == len){break;}
+        buffer[len] = '\0'; unsigned long long value = strtoull(buffer + start, NULL, 16);
+        for (int bit = 0; value != 0 && bit < kernel_long_bits; bit++, value >>= 1){
+            int code = word * kernel_long_bits + bit;
+            if ((value & 1) && code <= KEY_MAX){entry->key_bits[code / evdev_bits_per_long] |= 1UL << (code % evdev_bits_per_long);}
+        }
+        len = start;
+    }
+    strncpy(entry->node, node, NAME_MAX);
+    if (debug){print_stderr("Indexed '%s': '%s', id:%04x:%04x, phys:'%s'\n", node, entry->name, entry->vendor, entry->product, entry->phys);}
+    return entry;
+}
+
+static void evdev_index_remove(const char* node){ //drop device index entry, node may be reused by another device
+    for (int i=0; i<evdev_index_max; i++){if (strcmp(evdev_index[i].node, node) == 0){evdev_index[i].node[0] = '\0';}}
+}
+
+static bool evdev_info_from_fd(int fd, evdev_info_t* info){ //device infos from opened event device, used if not indexed, return false on failure
+    memset(info, 0, sizeof(evdev_info_t));
+    if (ioctl(fd, EVIOCGNAME(sizeof(info->name)), info->name) < 0 || info->name[0] == '\0'){return false;}
+    ioctl(fd, EVIOCGPHYS(sizeof(info->phys)), info->phys);
+    struct input_id id; if (ioctl(fd, EVIOCGID, &id) == 0){info->vendor = id.vendor; info->product = id.product;}
+    ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(info->key_bits)), info->key_bits);
+    return true;
+}
 
-//integer manipulation functs
-static int int_constrain(int* val, int min, int max){ //limit int value to given (incl) min and max value, return 0 if val within min and max, -1 under min, 1 over max
-    int ret = 0;
-    if (*val < min){*val = min; ret = -1;} else if (*val > max){*val = max; ret = 1;}
-    return ret;
+static bool evdev_info_match(const evdev_info_t* info){ //device in names list (name, id:vendor:product or phys:), or reporting all keys of a trigger sequence
+    for (int i=0; i<evdev_names_count; i++){
+        const char *entry = evdev_names[i]; unsigned int vendor, product;
+        if (strncmp(entry, "id:", 3) == 0){if (sscanf(entry + 3, "%x:%x", &vendor, &product) == 2 && vendor == info->vendor && product == info->product){return true;}
+        } else if (strncmp(entry, "phys:", 5) == 0){if (strcmp(entry + 5, info->phys) == 0){return true;}
+        } else if (strcmp(entry, info->name) == 0){return true;}
+    }
+    if (!evdev_capability_filter){return false;}
+    for (int i=0; i<evdev_combos_count; i++){
+        const evdev_combo_t *combo = &evdev_combos[i];
+        int word = combo->word_first;
+        while (word <= combo->word_last && (info->key_bits[word] & combo->keys[word]) == combo->keys[word]){word++;}
+        if (word > combo->word_last){return true;} //all keys reported
+    }
+    return false;
 }
 
+static bool evdev_device_open(const char* path, bool force){ //open input device if matching (or forced) and not already opened, matched from device index without opening node if indexed, register into main loop, return true if opened
+    struct stat file_stat;
+    if (stat(path, &file_stat) != 0){return false;}
+    for (int i=0; i<evdev_devices_max; i++){if (evdev_devices[i].fd != -1 && evdev_devices[i].rdev == file_stat.st_rdev && evdev_devices[i].ino == file_stat.st_ino){return false;}} //already opened
 
-//evdev functs
-#ifndef NO_EVDEV
-static int in_array_int(int* arr, int value, int arr_size){ //search in value in int array, return index or -1 on failure
-    for (int i=0; i < arr_size; i++) {if (arr[i] == value) {return i;}}
-    return -1;
+    const char *node = strrchr(path, '/'); node = (node != NULL) ? node + 1 : path;
+    evdev_info_t *info = evdev_index_get(node), fd_info;
+    if (info != NULL && !force && !evdev_info_match(info)){return false;} //not matching, node never opened
+
+    int slot = 0; while (slot < evdev_devices_max && evdev_devices[slot].fd != -1){slot++;}
+    if (slot == evdev_devices_max){if (debug){print_stderr("Devices table full, '%s' ignored\n", path);} return false;}
+
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0){if (debug){print_stderr("Failed to open '%s'\n", path);} return false;}
+    if (info == NULL){ //not indexed, match from device itself
+        if (!evdev_info_from_fd(fd, &fd_info)){if (debug){print_stderr("Failed to get device name for '%s'\n", path);} close(fd); return false;}
+        if (!force && !evdev_info_match(&fd_info)){close(fd); return false;}
+        info = &fd_info;
+    }
+    const char *name = info->name;
+
+    //only deliver configured keys, idle or not (sticks, motion...) other events never wake main loop, key type filtered again on read if not supported
+    unsigned long type_mask[1] = {1UL << EV_KEY};
+    struct input_mask masks[2] = {{.type = EV_SYN, .codes_size = sizeof(type_mask), .codes_ptr = (uint64_t)(uintptr_t)type_mask}, {.type = EV_KEY, .codes_size = sizeof(evdev_key_mask), .codes_ptr = (uint64_t)(uintptr_t)evdev_key_mask}};
+    if ((ioctl(fd, EVIOCSMASK, &masks[1]) < 0 || ioctl(fd, EVIOCSMASK, &masks[0]) < 0) && debug){print_stderr("EVIOCSMASK failed for '%s', errno:%d\n", path, errno);}
+
+    int clock_id = CLOCK_MONOTONIC; //event timestamps comparable to get_time_double()
+    evdev_devices[slot].monotonic = ioctl(fd, EVIOCSCLOCKID, &clock_id) == 0;
+    if (!evdev_devices[slot].monotonic && debug){print_stderr("EVIOCSCLOCKID failed for '%s', errno:%d, read time used instead of event time\n", path, errno);}
+
+    if (!loop_fd_add(fd, LOOP_SRC_EVDEV, slot)){close(fd); return false;}
+    evdev_devices[slot].fd = fd; evdev_devices[slot].rdev = file_stat.st_rdev; evdev_devices[slot].ino = file_stat.st_ino;
+    strncpy(evdev_devices[slot].path, path, PATH_MAX - 1); strncpy(evdev_devices[slot].name, name, sizeof(evdev_devices[slot].name) - 1);
+    memset(evdev_devices[slot].keys, 0, sizeof(evdev_devices[slot].keys)); evdev_keys_sync(slot, false); //keys already held
+    evdev_devices_count++;
+    print_stderr("'%s' will be used for '%s' device\n", path, name);
+    return true;
 }
 
-void evdev_check(double loop_start_time){ //evdev input check
-    static bool evdev_init = false;
-    if (!evdev_init && evdev_path[0] == '\0'){print_stderr("Empty event device path, EVDEV disabled\n"); evdev_enabled = false; return;}
+static void evdev_device_close(int slot){ //unregister and close input device
+    if (evdev_devices[slot].fd == -1){return;}
+    evdev_keys_sync(slot, true); //held keys released, other devices state kept
+    loop_fd_remove(evdev_devices[slot].fd); close(evdev_devices[slot].fd);
+    evdev_devices[slot].fd = -1; evdev_devices_count--;
+}
 
-    //input sequence spliting
-    static int osd_evdev_sequence_limit = 0;
-    static int tinyosd_evdev_sequence_limit = 0;
+static void evdev_scan(double now){ //open all matching input devices not opened yet, list devices if no filter set
+    evdev_scan_time = now;
+    struct stat evdev_stat;
+    if (stat(evdev_path, &evdev_stat) != 0){if (debug){print_stderr("Failed to open '%s'\n", evdev_path);} return;}
+    if (S_ISCHR(evdev_stat.st_mode) || S_ISREG(evdev_stat.st_mode)){evdev_device_open(evdev_path, true); return;} //given path is a device
+    if (!S_ISDIR(evdev_stat.st_mode)){print_stderr("Invalid file type for '%s', EVDEV disabled\n", evdev_path); evdev_enabled = false; return;}
+
+    bool scan_mode = evdev_names_count == 0 && !evdev_capability_filter; //no filter, just output all devices and paths
+    memset(evdev_index, 0, sizeof(evdev_index)); //full scan, removals may have been missed
+    struct dirent **folder_list;
+    int folder_files = scandir(evdev_path, &folder_list, 0, alphasort);
+    if (folder_files < 0){if (debug){print_stderr("Failed to scan '%s'\n", evdev_path);} return;}
+    for (int i=0; i<folder_files; i++){
+        char *file = folder_list[i]->d_name;
+        if (strncmp(file, "event", 5) == 0){
+            char path[PATH_MAX + 256]; snprintf(path, sizeof(path), "%s/%s", evdev_path, file);
+            if (scan_mode){
+                evdev_info_t *info = evdev_index_get(file), fd_info; int fd;
+                if (info == NULL && (fd = open(path, O_RDONLY | O_CLOEXEC)) >= 0){if (evdev_info_from_fd(fd, &fd_info)){info = &fd_info;} close(fd);} //not indexed
+                if (info != NULL){print_stderr("'%s' : '%s' (id:%04x:%04x, phys:'%s')\n", path, info->name, info->vendor, info->product, info->phys);}
+            } else {evdev_device_open(path, false);}
+        }
+        free(folder_list[i]);
+    }
+    free(folder_list);
+    if (scan_mode){print_stderr("Scan finished, EVDEV disabled\n"); evdev_enabled = false;}
+}
 
-    #ifndef NO_OSD
-        static int osd_evdev_sequence[evdev_sequence_max] = {0}; //int value of sequence, 0 will be interpreted as ignore, computed during runtime
-        if (!evdev_init){
-            if (osd_evdev_sequence_char[0] == '-'){osd_evdev_sequence_char[0] = '\0';} //assime '-' char as first char as -1
-            if (osd_evdev_sequence_char[0] != '\0'){
-                print_stderr("OSD sequence: ");
-                int index = 0;
-                char buffer[strlen(osd_evdev_sequence_char) + 1]; strcpy(buffer, osd_evdev_sequence_char);
-                char *tmp_ptr = strtok(buffer, ","); //split element
-                while (tmp_ptr != NULL){
-                    if (strchr(tmp_ptr, 'x') == NULL){osd_evdev_sequence[index] = atoi(tmp_ptr);} else {sscanf(tmp_ptr, "0x%X", &osd_evdev_sequence[index]);} //int or hex value
-                    if (osd_evdev_sequence[index] == -1){osd_evdev_sequence[index] = 0;} else {fprintf(stderr, "%d ", osd_evdev_sequence[index]); index++;}
-                    if (index >= evdev_sequence_max){break;} //avoid overflow
-                    tmp_ptr = strtok(NULL, ","); //next element
+static void evdev_process(int slot, double now){ //read pending events of input device, feed trigger sequences detection with kernel event time, close device if gone
+    if (evdev_devices[slot].fd == -1){return;} //closed by hotplug event of same wakeup
+    struct input_event events[64];
+    ssize_t len;
+    while ((len = read(evdev_devices[slot].fd, events, sizeof(events))) >= (ssize_t)sizeof(struct input_event)){
+        for (int i=0; i < len / (ssize_t)sizeof(struct input_event); i++){
+            if (events[i].type == EV_KEY){
+                double event_time = events[i].input_event_sec + events[i].input_event_usec / 1e6;
+                if (!evdev_devices[slot].monotonic || event_time <= 0. || event_time > now){event_time = now; //realtime clock or missing timestamp
+                } else { //processing delay, main loop busy or stalled by osd redraw
+                    double delay = now - event_time;
+                    evdev_delay_sum += delay; evdev_delay_count++;
+                    if (delay > evdev_delay_max){evdev_delay_max = delay;}
                 }
-                osd_evdev_sequence_limit = index;
-                fprintf(stderr, "(%d)\n", index);
-            }
+                evdev_key(slot, events[i].code, events[i].value, event_time);
+            } else if (events[i].type == EV_SYN && events[i].code == SYN_DROPPED){evdev_keys_sync(slot, false);} //kernel buffer overrun, releases may be lost
         }
-    #endif
+    }
+    if (len == 0 || (len < 0 && errno != EAGAIN)){ //device gone
+        print_stderr("Failed to read from device '%s' (%s), errno:%d%s\n", evdev_devices[slot].name, evdev_devices[slot].path, (len == 0) ? 0 : errno, (evdev_inotify_fd != -1) ? ", reopened once back" : ((evdev_devices_count == 1) ? ", rescan until found" : ""));
+        evdev_device_close(slot);
+    }
+}
 
-    #ifndef NO_TINYOSD
-        static int tinyosd_evdev_sequence[evdev_sequence_max] = {0}; //int value of sequence, 0 will be interpreted as ignore, computed during runtime
-        if (!evdev_init){
-            if (tinyosd_evdev_sequence_char[0] == '-'){tinyosd_evdev_sequence_char[0] = '\0';} //assime '-' char as first char as -1
-            if (tinyosd_evdev_sequence_char[0] != '\0'){
-                print_stderr("Tiny OSD sequence: ");
-                int index = 0;
-                char buffer[strlen(tinyosd_evdev_sequence_char) + 1]; strcpy(buffer, tinyosd_evdev_sequence_char);
-                char *tmp_ptr = strtok(buffer, ","); //split element
-                while (tmp_ptr != NULL){
-                    if (strchr(tmp_ptr, 'x') == NULL){tinyosd_evdev_sequence[index] = atoi(tmp_ptr);} else {sscanf(tmp_ptr, "0x%X", &tinyosd_evdev_sequence[index]);} //int or hex value
-                    if (tinyosd_evdev_sequence[index] == -1){tinyosd_evdev_sequence[index] = 0;} else {fprintf(stderr, "%d ", tinyosd_evdev_sequence[index]); index++;}
-                    if (index >= evdev_sequence_max){break;} //avoid overflow
-                    tmp_ptr = strtok(NULL, ","); //next element
-                }
-                tinyosd_evdev_sequence_limit = index;
-                fprintf(stderr, "(%d)\n", index);
+static bool evdev_key_state(int slot, int code, bool pressed){ //update keys held by input device and by any device, rearm held sequences using released key, return false if state unchanged
+    int word = code / evdev_bits_per_long; unsigned long bit = 1UL << (code % evdev_bits_per_long);
+    unsigned long *device_keys = evdev_devices[slot].keys;
+    if (((device_keys[word] & bit) != 0) == pressed){return false;}
+    if (pressed){
+        device_keys[word] |= bit;
+        if (evdev_key_holders[code]++ == 0){evdev_pressed[word] |= bit;}
+    } else {
+        device_keys[word] &= ~bit;
+        if (--evdev_key_holders[code] == 0){ //released on all devices
+            evdev_pressed[word] &= ~bit;
+            for (int word = 0; word < evdev_combo_longs; word++){
+                for (unsigned long combos = evdev_key_combos[code][word]; combos != 0; combos &= combos - 1){evdev_combos[word * evdev_bits_per_long + __builtin_ctzl(combos)].armed = true;}
             }
         }
-    #endif
+    }
+    return true;
+}
 
-    if (!evdev_init){
-        if (osd_evdev_sequence_limit == 0 && tinyosd_evdev_sequence_limit == 0){print_stderr("No valid event sequence detected, EVDEV disabled\n"); evdev_enabled = false; return;
-        } else if (osd_evdev_sequence_limit == 0){print_stderr("OSD sequence disabled\n");
-        } else if (tinyosd_evdev_sequence_limit == 0){print_stderr("Tiny OSD sequence disabled\n");}
-    }
-
-    //event input
-    static int evdev_path_len;
-    static double evdev_sequence_detect_interval; //max interval between first and last input detected in seconds, defined during runtime
-    static double recheck_start_time = -1., evdev_detected_start = -1.; //time of first detected input
-    #define input_event_count 64 //absolute limit simultanious event report
-    static struct input_event events[input_event_count];
-    static int input_event_size, events_size;
-    static int evdev_detected_sequence[evdev_sequence_max * 2] = {0}, evdev_detected_sequence_index = 0; //list of detect sequence (incl osd and tiny osd)
-
-    if (!evdev_init){
-        evdev_path_len = strlen(evdev_path);
-        if (evdev_path_len > 1 && evdev_path[evdev_path_len - 1] == '/'){evdev_path[evdev_path_len - 1] = '\0'; evdev_path_len--;} //remove trailing '/' from event path
-        evdev_sequence_detect_interval = (double)evdev_sequence_detect_interval_ms / 1000.;
-        input_event_size = (int) sizeof(struct input_event); events_size = input_event_size * input_event_count;
-        evdev_init = true;
-    }
-
-    if (evdev_fd == -1 && loop_start_time - recheck_start_time > (double)evdev_check_interval){ //device has failed or not started
-        bool evdev_retry = true;
-        char evdev_name[255] = ""; //store temporary device name
-        if (evdev_path_used[0] == '\0'){ //input device detection
-            struct stat evdev_stat;
-            if (stat(evdev_path, &evdev_stat) == 0){
-                if (S_ISDIR(evdev_stat.st_mode)){ //given path is a folder, scan for proper event file
-                    struct dirent **folder_list;
-                    int folder_files = scandir(evdev_path, &folder_list, 0, 0);
-                    if (folder_files != -1){
-                        bool scan_mode = evdev_name_search[0] == '\0';
-                        if (scan_mode){print_stderr("No event device name provided, falling back to scan mode\n");}
-                        for (int i = 0; i < folder_files; i++){
-                            char* evdev_file_tmp = folder_list[i]->d_name;
-                            if (evdev_file_tmp[0] == '.'){continue;} //ignore hidden files
-                            char evdev_path_tmp[evdev_path_len + strlen(evdev_file_tmp) + 2]; sprintf(evdev_path_tmp, "%s/%s", evdev_path, evdev_file_tmp);
-                            evdev_fd = open(evdev_path_tmp, O_RDONLY);
-                            if (evdev_fd < 0){continue;} //failed to open file
-                            evdev_name[0] = '\0'; ioctl(evdev_fd, EVIOCGNAME(sizeof(evdev_name)), evdev_name); close(evdev_fd); //get device name
-                            if (evdev_name[0] != '\0'){
-                                if (scan_mode){print_stderr("'%s' : '%s'\n", evdev_path_tmp, evdev_name); //no device name provided, just output all devices and paths
-                                } else if (strcmp(evdev_name_search, evdev_name) == 0){strncpy(evdev_path_used, evdev_path_tmp, sizeof(evdev_path_used)); break;} //proper device found
-                            }
-                        }
-                        free(folder_list);
-                        if (scan_mode){print_stderr("Scan finished\n"); evdev_retry = false;}
-                    } else if (debug){print_stderr("'%s' folder is empty\n", evdev_path);}
-                } else if (S_ISREG(evdev_stat.st_mode)){ //given path is a file
-                    evdev_fd = open(evdev_path, O_RDONLY);
-                    if (evdev_fd < 0){if (debug){print_stderr("Failed to open '%s'\n", evdev_path);} //failed to open file
-                    } else {
-                        ioctl(evdev_fd, EVIOCGNAME(sizeof(evdev_name)), evdev_name); close(evdev_fd); //get device name
-                        if (evdev_name[0] != '\0'){
-                            strncpy(evdev_path_used, evdev_path, sizeof(evdev_path_used));
-                            strncpy(evdev_name_search, evdev_name, sizeof(evdev_name_search));
-                        } else {if (debug){print_stderr("Failed to detect device name for '%s'\n", evdev_path);} evdev_retry = false;}
-                    }
-                } else if (debug){print_stderr("Invalid file type for '%s'\n", evdev_path); evdev_retry = false;}
-            } else if (debug){print_stderr("Failed to open '%s'\n", evdev_path);}
+static void evdev_keys_sync(int slot, bool release){ //resync keys held by input device from kernel state, release all of them instead if requested, no sequence triggered
+    unsigned long keys[evdev_key_longs] = {0};
+    if (!release && ioctl(evdev_devices[slot].fd, EVIOCGKEY(sizeof(keys)), keys) < 0){return;}
+    for (int word = 0; word < evdev_key_longs; word++){
+        for (unsigned long changed = (keys[word] & evdev_key_mask[word]) ^ evdev_devices[slot].keys[word]; changed != 0; changed &= changed - 1){
+            int bit = __builtin_ctzl(changed);
+            evdev_key_state(slot, word * evdev_bits_per_long + bit, (keys[word] >> bit) & 1);
         }
-        evdev_fd = -1;
+    }
+}
 
-        if (evdev_path_used[0] != '\0'){ //"valid" device found
-            evdev_fd = open(evdev_path_used, O_RDONLY);
-            if (evdev_fd < 0){if (debug){print_stderr("Failed to open '%s'\n", evdev_path_used);} //failed to open file
-            } else {
-                evdev_name[0] = '\0'; ioctl(evdev_fd, EVIOCGNAME(sizeof(evdev_name)), evdev_name); //get device name
-                if (evdev_name[0] == '\0'){if (debug){print_stderr("Failed to get device name for '%s'\n", evdev_path_used);} close(evdev_fd); evdev_fd = -1;
-                } else {
-                    fcntl(evdev_fd, F_SETFL, fcntl(evdev_fd, F_GETFL) | O_NONBLOCK); //set fd to non blocking
-                    if (debug){print_stderr("'%s' will be used for '%s' device\n", evdev_path_used, evdev_name);}
-                }
-            }
-        }
+static void evdev_key(int slot, int code, int value, double now){ //key event from input device, check sequences using pressed key
+    if (code <= 0 || code > KEY_MAX || value == 2){return;} //autorepeat ignored
+    if (!evdev_key_state(slot, code, value != 0) || value == 0){return;} //release, or press already known
 
-        if (evdev_fd == -1){
-            if (evdev_name_search[0] != '\0' && debug){print_stderr("Can't poll from '%s' device\n", evdev_name_search);}
-            if (evdev_retry){if (debug){print_stderr("Retry in %ds\n", evdev_check_interval);}} else {print_stderr("Evdev disabled\n"); evdev_enabled = false; return;}
+    for (int word = 0; word < evdev_key_longs; word++){ //drop keys pressed before detection interval
+        for (unsigned long bits = evdev_recent[word]; bits != 0; bits &= bits - 1){
+            int bit = __builtin_ctzl(bits);
+            if (now - evdev_key_press_time[word * evdev_bits_per_long + bit] > evdev_sequence_detect_interval){evdev_recent[word] &= ~(1UL << bit);}
+        }
+    }
+    evdev_recent[code / evdev_bits_per_long] |= 1UL << (code % evdev_bits_per_long); evdev_key_press_time[code] = now;
+
+    for (int combo_word = 0; combo_word < evdev_combo_longs; combo_word++){
+        for (unsigned long combos = evdev_key_combos[code][combo_word]; combos != 0; combos &= combos - 1){ //only sequences using this key
+            int i = combo_word * evdev_bits_per_long + __builtin_ctzl(combos); evdev_combo_t *combo = &evdev_combos[i];
+            if (combo->held && !combo->armed){continue;} //already triggered, wait for one of its keys release
+            const unsigned long *state = combo->held ? evdev_pressed : evdev_recent;
+            int word = combo->word_first;
+            while (word <= combo->word_last && (state[word] & combo->keys[word]) == combo->keys[word]){word++;}
+            if (word <= combo->word_last){continue;} //keys missing
+
+            if (debug){print_stderr("%s sequence %d detected\n", evdev_action_names[combo->action], i);}
+            if (combo->held){combo->armed = false;
+            } else {for (word = combo->word_first; word <= combo->word_last; word++){evdev_recent[word] &= ~combo->keys[word];}} //keys consumed, pressed again to retrigger
+            evdev_action(combo->action, now);
         }
-
-        recheck_start_time = loop_start_time;
     }
+}
 
-    if (evdev_fd == -1){
-        return;
-    } else {
-        int events_read = read(evdev_fd, &events, events_size);
-        if (errno == ENODEV || errno == ENOENT || errno == EBADF){
-            if (debug){print_stderr("Failed to read from device '%s' (%s), try to reopen in %ds\n", evdev_name_search, evdev_path_used, evdev_check_interval);}
-            close(evdev_fd); evdev_fd = -1; return;
-        } else if (events_read >= input_event_size){
-            if (evdev_detected_start > 0. && loop_start_time - evdev_detected_start > evdev_sequence_detect_interval){ //reset sequence
-                memset(evdev_detected_sequence, 0, sizeof(evdev_detected_sequence));
-                evdev_detected_sequence_index = 0; evdev_detected_start = -1.;
-                if (debug){print_stderr("Sequence timer reset\n");}
-            }
+static void evdev_action(uint8_t action, double now){ //run action of detected trigger sequence
+    switch (action){
+        case EVDEV_ACTION_OSD: osd_trigger(false, now, "evdev"); break;
+        case EVDEV_ACTION_TINYOSD: osd_trigger(true, now, "evdev"); break;
+        case EVDEV_ACTION_HIDE: osd_hide(now, "evdev"); break;
+    }
+}
+#endif
 
-            for (int i = 0; i < events_read / input_event_size; i++){
-                //printf("%ld.%06ld, type:%u, code:%u, value:%d\n", events[i].time.tv_sec, events[i].time.tv_usec, events[i].type, events[i].code, events[i].value);
-                int tmp_code = events[i].code;
-                #ifndef NO_OSD
-                    bool code_osd_detect = (osd_evdev_sequence_limit == 0) ? false : in_array_int(osd_evdev_sequence, tmp_code, osd_evdev_sequence_limit) != -1;
-                #else
-                    bool code_osd_detect = false;
-                #endif
-                #ifndef NO_TINYOSD
-                    bool code_tinyosd_detect = (tinyosd_evdev_sequence_limit == 0) ? false : in_array_int(tinyosd_evdev_sequence, tmp_code, tinyosd_evdev_sequence_limit) != -1;
-                #else
-                    bool code_tinyosd_detect = false;
-                #endif
 
-                if (tmp_code != 0 && events[i].value != 0 && (code_osd_detect || code_tinyosd_detect)){ //keycode in osd or tiny osd sequence
-                    if (evdev_detected_start < 0.){ //check not started
-                        evdev_detected_start = loop_start_time;
-                        if (debug){print_stderr("Sequence timer start\n");}
-                    }
-                    if (loop_start_time - evdev_detected_start <= evdev_sequence_detect_interval && in_array_int(evdev_detected_sequence, tmp_code, evdev_sequence_max * 2) == -1){ //still in detection interval and not in detected sequence
-                        evdev_detected_sequence[evdev_detected_sequence_index++] = tmp_code;
-                        if (debug){print_stderr("%d added to detected sequence\n", tmp_code);}
-                    }
-                }
-            }
+//main loop functs
+static bool loop_fd_add(int fd, int source, int index){ //register fd into main loop epoll set, return false on failure
+    if (loop_epoll_fd < 0 || fd < 0){return false;}
+    struct epoll_event event = {.events = EPOLLIN, .data.u64 = ((uint64_t)source << 32) | (uint32_t)index};
+    if (epoll_ctl(loop_epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0){print_stderr("epoll_ctl failed to add fd:%d, errno:%d.\n", fd, errno); return false;}
+    return true;
+}
 
-            #if !(defined(NO_OSD) && defined(NO_TINYOSD))
-                if (evdev_detected_sequence_index != 0){
-                    #ifndef NO_OSD
-                        int tmp_detected_count = 0;
-                        for (int i = 0; i < osd_evdev_sequence_limit; i++){if (osd_evdev_sequence[i] != 0 && in_array_int(evdev_detected_sequence, osd_evdev_sequence[i], evdev_sequence_max * 2) != -1){tmp_detected_count++;}} //check osd trigger
-                        if (tmp_detected_count == osd_evdev_sequence_limit){
-                            if (debug){print_stderr("Tiny OSD triggered\n");}
-                            if (tinyosd_start_time < 0.){osd_start_time = loop_start_time;} else {osd_hold = true;}
-                            evdev_detected_start = 1.; //1. on purpose, does reset sequence on next loop
-                        }
-                    #endif
-                    #ifndef NO_TINYOSD
-                        #ifdef NO_OSD
-                            int tmp_detected_count = 0;
-                        #else
-                            tmp_detected_count = 0;
-                        #endif
-                        for (int i = 0; i < tinyosd_evdev_sequence_limit; i++){if (tinyosd_evdev_sequence[i] != 0 && in_array_int(evdev_detected_sequence, tinyosd_evdev_sequence[i], evdev_sequence_max * 2) != -1){tmp_detected_count++;}} //check tiny osd trigger
-                        if (tmp_detected_count == tinyosd_evdev_sequence_limit){
-                            if (debug){print_stderr("OSD triggered\n");}
-                            if (osd_start_time < 0.){tinyosd_start_time = loop_start_time;} else {tinyosd_hold = true;}
-                            evdev_detected_start = 1.; //1. on purpose, does reset sequence on next loop
-                        }
-                    #endif
-                }
-            #endif
-        }
-    }
+#if !defined(NO_EVDEV) || !defined(NO_CONTROL_SOCKET) || (defined(USE_GPIOD) && !defined(NO_GPIO))
+static void loop_fd_remove(int fd){ //unregister fd from main loop epoll set
+    if (loop_epoll_fd < 0 || fd < 0){return;}
+    epoll_ctl(loop_epoll_fd, EPOLL_CTL_DEL, fd, NULL);
 }
 #endif
 
+static void loop_timer_set(double deadline){ //(re)arm main loop timer to given absolute monotonic deadline in sec if changed
+    if (loop_timer_fd < 0 || deadline == loop_timer_deadline){return;}
+    struct itimerspec timer_spec = {0}; //disarmed if deadline < 0
+    if (deadline > 0.){timer_spec.it_value.tv_sec = (time_t)deadline; timer_spec.it_value.tv_nsec = (long)((deadline - (time_t)deadline) * 1e9);}
+    if (timer_spec.it_value.tv_sec == 0 && timer_spec.it_value.tv_nsec == 0 && deadline >= 0.){timer_spec.it_value.tv_nsec = 1;} //already expired, zero would disarm
+    if (timerfd_settime(loop_timer_fd, TFD_TIMER_ABSTIME, &timer_spec, NULL) != 0){print_stderr("timerfd_settime failed, errno:%d.\n", errno); return;}
+    loop_timer_deadline = deadline;
+}
+
 
 //generic
 static bool html_to_uint32_color(char* html_color, uint32_t* rgba){ //convert html color (3/4 or 6/8 hex) to uint32_t (alpha, blue, green, red)
@@ -1226,26 +2160,192 @@ static bool html_to_uint32_color(char* html_color, uint32_t* rgba){ //convert ht
     return true;
 }
 
-static void tty_signal_handler(int sig){ //handle signal func
-    if (debug){print_stderr("DEBUG: signal received: %d.\n", sig);}
-    if (sig == SIGUSR1){
-        #if !defined(NO_SIGNAL) && !defined(NO_OSD)
-            if (tinyosd_start_time < 0.){osd_start_time = get_time_double();} else {osd_hold = true;}
+#if !(defined(NO_OSD) && defined(NO_TINYOSD))
+static void osd_trigger(bool tiny, double trigger_time, const char* source){ //display full or tiny osd, put on hold if other one already displayed
+    if (debug){print_stderr("%s triggered by %s\n", tiny ? "Tiny OSD" : "OSD", source);}
+    if (!tiny){
+        if (tinyosd_start_time < 0.){
+            if (osd_start_time < 0.){osd_trigger_time = trigger_time;} //not displayed yet, measure latency
+            osd_start_time = trigger_time;
+        } else {osd_hold = true;}
+    } else {
+        if (osd_start_time < 0.){
+            if (tinyosd_start_time < 0.){tinyosd_trigger_time = trigger_time;} //not displayed yet, measure latency
+            tinyosd_start_time = trigger_time;
+        } else {tinyosd_hold = true;}
+    }
+}
+
+static void osd_hide(double now, const char* source){ //hide displayed osd, cancel held and pending ones
+    if (debug){print_stderr("OSD hidden by %s\n", source);}
+    #ifndef NO_OSD
+        osd_hold = false; osd_trigger_time = -1.;
+        if (osd_start_time > 0.){osd_start_time = now - osd_timeout - 1.;} //removed on next osd timeout check
+    #endif
+    #ifndef NO_TINYOSD
+        tinyosd_hold = false; tinyosd_trigger_time = -1.;
+        if (tinyosd_start_time > 0.){tinyosd_start_time = now - osd_timeout - 1.;}
+    #endif
+    #ifndef NO_CONTROL_SOCKET
+        ctl_displayed(FP_OSD_CTL_SHOW_OSD, -ECANCELED, now); ctl_displayed(FP_OSD_CTL_SHOW_TINYOSD, -ECANCELED, now); //pending show requests
+    #endif
+}
+#endif
+
+#ifndef NO_CONTROL_SOCKET
+static bool ctl_init(void){ //bind control socket, return false on failure
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(ctl_socket_path) >= sizeof(addr.sun_path)){print_stderr("control socket path too long.\n"); return false;}
+    strcpy(addr.sun_path, ctl_socket_path);
+    struct stat path_stat;
+    if (lstat(ctl_socket_path, &path_stat) == 0){
+        if (!S_ISSOCK(path_stat.st_mode)){print_stderr("'%s' exists and is not a socket, control socket disabled.\n", ctl_socket_path); return false;} //never unlink other files or symlinks
+        unlink(ctl_socket_path); //stale socket from previous run
+    }
+    ctl_listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    mode_t umask_prev = umask(~ctl_socket_mode & 0777); //socket node created with requested permissions, no chmod() on path
+    bool bound = ctl_listen_fd >= 0 && bind(ctl_listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+    umask(umask_prev);
+    if (!bound || listen(ctl_listen_fd, ctl_clients_max) != 0){
+        print_stderr("Failed to bind control socket '%s', errno:%d.\n", ctl_socket_path, errno);
+        if (ctl_listen_fd >= 0){close(ctl_listen_fd); ctl_listen_fd = -1;}
+        return false;
+    }
+    loop_fd_add(ctl_listen_fd, LOOP_SRC_CTL_LISTEN, 0);
+    print_stderr("Control socket: '%s' (%03o)\n", ctl_socket_path, ctl_socket_mode);
+    return true;
+}
+
+static void ctl_accept(void){ //accept pending control socket clients
+    int fd;
+    while ((fd = accept(ctl_listen_fd, NULL, NULL)) >= 0){
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK); fcntl(fd, F_SETFD, FD_CLOEXEC);
+        int slot = -1;
+        for (int i=0; i<ctl_clients_max; i++){if (ctl_client_fd[i] < 0){slot = i; break;}}
+        if (slot < 0){print_stderr("Too many control socket clients.\n"); close(fd); continue;}
+        ctl_client_fd[slot] = fd; ctl_client_waiting[slot] = false;
+        loop_fd_add(fd, LOOP_SRC_CTL_CLIENT, slot);
+    }
+}
+
+static void ctl_process(int slot, double now){ //handle client requests, close client on disconnect
+    fp_osd_ctl_request_t request; ssize_t len;
+    while ((len = recv(ctl_client_fd[slot], &request, sizeof(request), 0)) > 0){
+        int status = 0; bool wait = false;
+        if (len != sizeof(request) || request.version != fp_osd_ctl_version){status = -EPROTO;
+        } else if (request.cmd == FP_OSD_CTL_SHOW_OSD || request.cmd == FP_OSD_CTL_SHOW_TINYOSD){
+            bool tiny = request.cmd == FP_OSD_CTL_SHOW_TINYOSD;
+            if (!(ctl_available & (tiny ? FP_OSD_CTL_STATE_TINYOSD : FP_OSD_CTL_STATE_OSD))){status = -ENODEV; //disabled at compilation time or resource failed
+            } else if (ctl_client_waiting[slot]){status = -EBUSY; //previous show request not replied yet
+            } else {
+                #if !(defined(NO_OSD) && defined(NO_TINYOSD))
+                    bool displayed = tiny ? (tinyosd_start_time > 0. && tinyosd_trigger_time < 0.) : (osd_start_time > 0. && osd_trigger_time < 0.);
+                    osd_trigger(tiny, now, "control socket");
+                    wait = !displayed; //already displayed: timeout extended, replied right away
+                #endif
+            }
+        } else if (request.cmd == FP_OSD_CTL_HIDE){osd_hide(now, "control socket");
+        } else if (request.cmd == FP_OSD_CTL_SET_TIMEOUT){
+            int timeout = request.value;
+            if (int_constrain(&timeout, 1, 20) != 0){status = -EINVAL;} else {osd_timeout = timeout;}
+        } else if (request.cmd != FP_OSD_CTL_QUERY){status = -EINVAL;}
+
+        if (debug){print_stderr("control socket: client:%d, cmd:%u, value:%d, status:%d\n", slot, request.cmd, request.value, status);}
+        if (wait){ctl_client_request[slot] = request; ctl_client_waiting[slot] = true; //replied by ctl_displayed()
+        } else {ctl_reply(slot, &request, status, now);}
+    }
+    if (len == 0 || (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK)){ctl_client_close(slot);} //disconnected
+}
+
+static void ctl_reply(int slot, const fp_osd_ctl_request_t* request, int status, double time){ //send reply to client
+    fp_osd_ctl_reply_t reply = {.version = fp_osd_ctl_version, .cmd = request->cmd, .status = status, .timeout = osd_timeout, .request_id = request->request_id, .submit_time_ns = (uint64_t)(time * 1e9)};
+    #ifndef NO_OSD
+        if (osd_start_time > 0.){reply.state |= FP_OSD_CTL_STATE_OSD;}
+        if (osd_hold){reply.state |= FP_OSD_CTL_STATE_OSD_HOLD;}
+    #endif
+    #ifndef NO_TINYOSD
+        if (tinyosd_start_time > 0.){reply.state |= FP_OSD_CTL_STATE_TINYOSD;}
+        if (tinyosd_hold){reply.state |= FP_OSD_CTL_STATE_TINYOSD_HOLD;}
+    #endif
+    if (send(ctl_client_fd[slot], &reply, sizeof(reply), MSG_NOSIGNAL | MSG_DONTWAIT) != sizeof(reply)){ctl_client_close(slot);}
+}
+
+static void ctl_displayed(uint8_t cmd, int status, double time){ //reply to clients waiting for given show command
+    for (int i=0; i<ctl_clients_max; i++){
+        if (ctl_client_fd[i] >= 0 && ctl_client_waiting[i] && ctl_client_request[i].cmd == cmd){ctl_client_waiting[i] = false; ctl_reply(i, &ctl_client_request[i], status, time);}
+    }
+}
+
+static void ctl_client_close(int slot){ //close client connection
+    if (ctl_client_fd[slot] < 0){return;}
+    loop_fd_remove(ctl_client_fd[slot]); close(ctl_client_fd[slot]);
+    ctl_client_fd[slot] = -1; ctl_client_waiting[slot] = false;
+}
+#endif
+
+static void signal_fd_process(void){ //read all pending signals from signalfd, repeated triggers coalesced into one
+    struct signalfd_siginfo siginfo[8];
+    uint32_t usr1_count = 0, usr2_count = 0;
+    ssize_t len;
+    while ((len = read(signal_fd, siginfo, sizeof(siginfo))) >= (ssize_t)sizeof(struct signalfd_siginfo)){
+        for (int i=0; i < len / (ssize_t)sizeof(struct signalfd_siginfo); i++){
+            int sig = (int)siginfo[i].ssi_signo;
+            if (debug){print_stderr("DEBUG: signal received: %d from pid:%u.\n", sig, siginfo[i].ssi_pid);}
+            if (sig == SIGUSR1){usr1_count++;} else if (sig == SIGUSR2){usr2_count++;} else {kill_requested = true;}
+        }
+    }
+    if (usr1_count > 1 || usr2_count > 1){if (debug){print_stderr("Coalesced %u SIGUSR1, %u SIGUSR2.\n", usr1_count, usr2_count);}}
+
+    #ifndef NO_SIGNAL
+        double dequeue_time = get_time_double(); //trigger timestamp
+        #ifndef NO_OSD
+            if (usr1_count > 0){osd_trigger(false, dequeue_time, "SIGUSR1");}
         #endif
-    } else if (sig == SIGUSR2){
-        #if !defined(NO_SIGNAL) && !defined(NO_TINYOSD)
-            if (osd_start_time < 0.){tinyosd_start_time = get_time_double();} else {tinyosd_hold = true;}
+        #ifndef NO_TINYOSD
+            if (usr2_count > 0){osd_trigger(true, dequeue_time, "SIGUSR2");}
         #endif
-    } else {kill_requested = true;}
+    #endif
+}
+
+static void tty_signal_handler(int sig){ //handle signal func, only signals not delivered through signalfd, must stay async-signal-safe
+    kill_requested = true;
 }
 
 static void program_close(void){ //regroup all close functs
     if (already_killed){return;}
     if (pid_path[0] != '\0'){remove(pid_path); pid_path[0] = '\0';} //delete pid file
 
+    #if !(defined(NO_OSD) && defined(NO_TINYOSD))
+        sampler_thread_stop_join(); //stop sampler thread, close its eventfds
+    #endif
     #ifndef NO_EVDEV
-        if (evdev_fd != -1){close(evdev_fd);} //close opened event fd
+        for (int i=0; i<evdev_devices_max; i++){if (evdev_devices[i].fd != -1){close(evdev_devices[i].fd); evdev_devices[i].fd = -1;}} //close opened input devices
+        if (evdev_inotify_fd != -1){close(evdev_inotify_fd); evdev_inotify_fd = -1;} //close input devices folder watch
+    #endif
+    if (signal_fd != -1){close(signal_fd); signal_fd = -1;} //close signalfd
+    #ifndef NO_CONTROL_SOCKET
+        for (int i=0; i<ctl_clients_max; i++){if (ctl_client_fd[i] != -1){close(ctl_client_fd[i]); ctl_client_fd[i] = -1;}}
+        if (ctl_listen_fd != -1){close(ctl_listen_fd); ctl_listen_fd = -1; unlink(ctl_socket_path);} //close control socket
+    #endif
+    #ifndef NO_SIGNAL_FILE
+        if (signal_file_inotify_fd != -1){close(signal_file_inotify_fd); signal_file_inotify_fd = -1;} //close signal file inotify instance, removes watch
     #endif
+    #if !(defined(NO_OSD) && defined(NO_TINYOSD))
+        if (nl80211_fd != -1){close(nl80211_fd); nl80211_fd = -1;} //close generic netlink socket
+        sysfs_attr_close(&wireless_attr); sysfs_attr_close(&proc_stat_attr);
+    #endif
+    if (uevent_fd != -1){close(uevent_fd); uevent_fd = -1; if (uevent_test_socket_path[0] != '\0'){unlink(uevent_test_socket_path);}} //close uevent socket
+    sysfs_attr_close(&battery_rsoc_attr); sysfs_attr_close(&battery_volt_attr); sysfs_attr_close(&cpu_thermal_attr); //close sysfs attributes
+    #ifndef NO_OSD
+        sysfs_attr_close(&meminfo_attr);
+    #endif
+    #if !(defined(NO_OSD) && defined(NO_TINYOSD))
+        sysfs_attr_close(&backlight_attr); sysfs_attr_close(&backlight_max_attr);
+    #endif
+    if (shm_metrics_ptr != NULL){munmap(shm_metrics_ptr, sizeof(fp_osd_shm_t)); shm_metrics_ptr = NULL;} //unmap shared memory metrics, sampler thread already stopped
+    if (dispmanx_event_fd != -1){close(dispmanx_event_fd); dispmanx_event_fd = -1;} //close dispmanx update completion eventfd
+    if (loop_timer_fd != -1){close(loop_timer_fd); loop_timer_fd = -1;} //close main loop timer
+    if (loop_epoll_fd != -1){close(loop_epoll_fd); loop_epoll_fd = -1;} //close main loop epoll set
     #ifndef NO_OSD
         if (osd_buffer_ptr != NULL){free(osd_buffer_ptr); osd_buffer_ptr = NULL;} //free osd buffer
     #endif
@@ -1308,7 +2408,10 @@ static void program_usage(void){ //display help
     "\t-battery_voltage <PATH> (file containing battery voltage. Default:'%s').\n"
     "\t-battery_volt_divider <NUM> (voltage divider to get voltage. Default:'%u').\n"
     "\t-lowbat_limit <0-90> (threshold, used with -battery_rsoc. Default:%d).\n"
-    , battery_rsoc_path, battery_volt_path, battery_volt_divider, lowbat_limit);
+    "\t-uevent <0-1> (update battery data from kernel power_supply uevents. Default:%d).\n"
+    "\t-uevent_safety_poll <10-3600000> (battery percentage polling interval in millisec once uevents received. Default:%d).\n"
+    "\t-uevent_test_socket <PATH> (receive uevents from a unix datagram socket bound to given path instead of kernel, for test purpose).\n"
+    , battery_rsoc_path, battery_volt_path, battery_volt_divider, lowbat_limit, uevent_enabled?1:0, uevent_safety_poll_ms);
 #ifndef NO_GPIO
     fprintf(stderr,
     "\t-lowbat_gpio <PIN> (low battery gpio pin, -1 to disable. Default:%d).\n"
@@ -1319,16 +2422,19 @@ static void program_usage(void){ //display help
 #ifndef NO_EVDEV
     fprintf(stderr,"\nEVDEV input:\n"
     "\t-evdev_path <PATH> (folder or file to use as input device. Default:'%s').\n"
-    "\t-evdev_device <NAME> (device to search if -evdev_path is a folder. Default:'%s').\n"
-    "\t-evdev_failure_interval <NUM> (retry interval if input device failed. Default:'%d').\n"
-    "\t-evdev_detect_interval <NUM> (input sequence detection timeout in millisec. Default:'%d').\n"
-    , evdev_path, evdev_name_search, evdev_check_interval, evdev_sequence_detect_interval_ms);
+    "\t-evdev_device <NAME> (device to search if -evdev_path is a folder, repeat argument for each device, all matching devices are used, 'id:VVVV:PPPP' (hex) to match vendor and product, 'phys:PHYS' to match physical path. Default:'%s').\n"
+    "\t-evdev_sysfs <PATH> (input class sysfs folder, devices matched without opening their node, empty to always open nodes. Default:'%s').\n"
+    "\t-evdev_capability <0-1> (also use devices reporting all keys of a trigger sequence, regardless of their name. Default:%d).\n"
+    "\t-evdev_failure_interval <NUM> (rescan interval in sec while no input device opened, only if input devices folder can't be watched. Default:'%d').\n"
+    "\t-evdev_detect_interval <NUM> (input sequence detection timeout in millisec, ',' separated sequences only. Default:'%d').\n"
+    , evdev_path, evdev_name_search, evdev_sysfs_path, evdev_capability_filter?1:0, evdev_check_interval, evdev_sequence_detect_interval_ms);
 #ifndef NO_OSD
-    fprintf(stderr,"\t-evdev_osd_sequence <KEYCODE,KEYCODE,...> (OSD trigger sequence. -1 to disable. Default:'%s').\n", osd_evdev_sequence_char);
+    fprintf(stderr,"\t-evdev_osd_sequence <KEYCODE+KEYCODE;...> (OSD trigger sequences, '+' for keys held simultaneously, ',' for keys pressed within detection interval, ';' between sequences. -1 to disable. Default:'%s').\n", osd_evdev_sequence_char);
 #endif
 #ifndef NO_TINYOSD
-    fprintf(stderr,"\t-evdev_tinyosd_sequence <KEYCODE,KEYCODE,...> (Tiny OSD trigger sequence. -1 to disable. Default:'%s').\n", tinyosd_evdev_sequence_char);
+    fprintf(stderr,"\t-evdev_tinyosd_sequence <KEYCODE+KEYCODE;...> (Tiny OSD trigger sequences, same format as -evdev_osd_sequence. -1 to disable. Default:'%s').\n", tinyosd_evdev_sequence_char);
 #endif
+    fprintf(stderr,"\t-evdev_hide_sequence <KEYCODE+KEYCODE;...> (sequences hiding any displayed OSD, same format as -evdev_osd_sequence. -1 to disable. Default:'%s').\n", hide_evdev_sequence_char);
 #endif
 
 #ifndef NO_OSD
@@ -1384,7 +2490,8 @@ static void program_usage(void){ //display help
     "\t-cpu_thermal <PATH> (file containing CPU temperature. Default:'%s').\n"
     "\t-cpu_thermal_divider <NUM> (divider to get actual temperature in celsius. Default:'%u').\n"
     "\t-cpu_thermal_celsius <0-1> (display CPU temperature in celsius, post conversion to fahrenheit if 0. Default:'%d').\n"
-    , cpu_thermal_path, cpu_thermal_divider, cputemp_celsius?1:0);
+    "\t-shm <PATH> (shared memory metrics file written by producer daemons, valid fields preferred over backlight and battery files, empty to disable. Default:'%s').\n"
+    , cpu_thermal_path, cpu_thermal_divider, cputemp_celsius?1:0, shm_metrics_path);
 
 #if !(defined(NO_OSD) && defined(NO_TINYOSD))
     fprintf(stderr,
@@ -1393,14 +2500,36 @@ static void program_usage(void){ //display help
     "\t-backlight_max <PATH> (file containing backlight maximum value. Default:'%s').\n"
     , rtc_path, backlight_path, backlight_max_path);
 #endif
+#ifndef NO_OSD
+    fprintf(stderr,
+    "\t-gencmd_stub <PATH> (answer videocore gencmd queries from 'command:response' lines of given file, read again on each cache miss, to display gencmd data off-Pi).\n");
+#endif
+
+    fprintf(stderr, "\nData sources refresh intervals:\n");
+    for (int i=0; i<sampler_count; i++){fprintf(stderr, "\t-refresh_%s <10-3600000> (in millisec. Default:%d).\n", sampler_sources[i].name, *sampler_sources[i].interval_ms);}
 
     fprintf(stderr,
     "\nProgram:\n"
-    "\t-check <1-120> (check rate in hz. Default:%d).\n"
+    "\t-check <1-120> (refresh rate in hz while OSD displayed. Default:%d).\n"
     "\t-display <0-255> (Dispmanx display. Default:%u).\n"
     "\t-layer <NUM> (Dispmanx layer. Default:%u).\n"
+    "\t-dispmanx_async <0-1> (submit Dispmanx updates without waiting for completion, 0 for synchronous updates. Default:%d).\n"
     "\t-debug <0-1> (enable stderr debug output. Default:%d).\n"
-    , osd_check_rate, display_number, osd_layer, debug?1:0);
+    , osd_check_rate, display_number, osd_layer, dispmanx_async?1:0, debug?1:0);
+
+#ifndef NO_CONTROL_SOCKET
+    fprintf(stderr,
+    "\t-ctl_socket <PATH> (unix seqpacket control socket, use fp_osd_ctl program to send commands, empty to disable. Default:'%s').\n"
+    "\t-ctl_socket_mode <OCTAL> (control socket permissions, e.g. 0666 to allow any local user. Default:%03o).\n"
+    , ctl_socket_path, ctl_socket_mode);
+#endif
+#ifndef NO_GPIO
+    fprintf(stderr,
+    "\t-gpio_chip <PATH> (gpio character device used if no gpio library available. Default:'%s').\n"
+    "\t-gpio_debounce <0-1000> (gpio debounce in millisec, kernel debounce for gpio character device, software otherwise, 0 to disable. Default:%d).\n"
+    "\t-gpio_hold <0-10000> (osd stays displayed while its gpio is held longer than this in millisec, 0 to disable. Default:%d).\n"
+    , gpio_chip_path, gpio_debounce_ms, gpio_hold_ms);
+#endif
 
 #ifdef BUFFER_PNG_EXPORT
     fprintf(stderr,
@@ -1450,6 +2579,10 @@ int main(int argc, char *argv[]){
         } else if (strcmp(argv[i], "-battery_voltage") == 0){strncpy(battery_volt_path, argv[++i], PATH_MAX-1);
         } else if (strcmp(argv[i], "-battery_volt_divider") == 0){battery_volt_divider = atoi(argv[++i]);
             if (battery_volt_divider == 0){print_stderr("invalid -battery_volt_divider argument, reset to '1', value needs to be over 0\n"); battery_volt_divider = 1;}
+        } else if (strcmp(argv[i], "-uevent") == 0){uevent_enabled = atoi(argv[++i]) > 0;
+        } else if (strcmp(argv[i], "-uevent_safety_poll") == 0){uevent_safety_poll_ms = atoi(argv[++i]);
+            if (int_constrain(&uevent_safety_poll_ms, 10, 3600000) != 0){print_stderr("invalid -uevent_safety_poll argument, reset to '%d', allow from '10' to '3600000' (incl.)\n", uevent_safety_poll_ms);}
+        } else if (strcmp(argv[i], "-uevent_test_socket") == 0){strncpy(uevent_test_socket_path, argv[++i], PATH_MAX-1);
         } else if (strcmp(argv[i], "-lowbat_limit") == 0){lowbat_limit = atoi(argv[++i]);
             if (int_constrain(&lowbat_limit, 0, 90) != 0){print_stderr("invalid -lowbat_limit argument, reset to '%d', allow from '0' to '90' (incl.)\n", lowbat_limit);}
 #ifndef NO_GPIO
@@ -1460,7 +2593,11 @@ int main(int argc, char *argv[]){
         //EVDEV input
 #ifndef NO_EVDEV
         } else if (strcmp(argv[i], "-evdev_path") == 0){strncpy(evdev_path, argv[++i], sizeof(evdev_path));
-        } else if (strcmp(argv[i], "-evdev_device") == 0){strncpy(evdev_name_search, argv[++i], sizeof(evdev_name_search));
+        } else if (strcmp(argv[i], "-evdev_device") == 0){evdev_name_search[0] = '\0'; i++; //repeatable, one name per argument so names can contain any character, replaces default name
+            if (evdev_names_count == evdev_names_max){print_stderr("Too many -evdev_device arguments, '%s' ignored (%d max)\n", argv[i], evdev_names_max);
+            } else if (argv[i][0] != '\0'){strncpy(evdev_names[evdev_names_count++], argv[i], sizeof(evdev_names[0]) - 1);}
+        } else if (strcmp(argv[i], "-evdev_sysfs") == 0){strncpy(evdev_sysfs_path, argv[++i], PATH_MAX-1);
+        } else if (strcmp(argv[i], "-evdev_capability") == 0){evdev_capability_filter = atoi(argv[++i]) > 0;
         } else if (strcmp(argv[i], "-evdev_failure_interval") == 0){evdev_check_interval = atoi(argv[++i]);
         } else if (strcmp(argv[i], "-evdev_detect_interval") == 0){evdev_sequence_detect_interval_ms = atoi(argv[++i]);
     #ifndef NO_OSD
@@ -1469,6 +2606,7 @@ int main(int argc, char *argv[]){
     #ifndef NO_TINYOSD
         } else if (strcmp(argv[i], "-evdev_tinyosd_sequence") == 0){strncpy(tinyosd_evdev_sequence_char, argv[++i], sizeof(tinyosd_evdev_sequence_char));
     #endif
+        } else if (strcmp(argv[i], "-evdev_hide_sequence") == 0){strncpy(hide_evdev_sequence_char, argv[++i], sizeof(hide_evdev_sequence_char));
 #endif
 
         //OSD display
@@ -1514,11 +2652,25 @@ int main(int argc, char *argv[]){
         } else if (strcmp(argv[i], "-rtc") == 0){strncpy(rtc_path, argv[++i], PATH_MAX-1);
         } else if (strcmp(argv[i], "-backlight") == 0){strncpy(backlight_path, argv[++i], PATH_MAX-1);
         } else if (strcmp(argv[i], "-backlight_max") == 0){strncpy(backlight_max_path, argv[++i], PATH_MAX-1);
+#endif
+#ifndef NO_OSD
+        } else if (strcmp(argv[i], "-gencmd_stub") == 0){strncpy(gencmd_stub_path, argv[++i], PATH_MAX-1); gencmd_provider = gencmd_stub;
 #endif
         } else if (strcmp(argv[i], "-cpu_thermal") == 0){strncpy(cpu_thermal_path, argv[++i], PATH_MAX-1);
         } else if (strcmp(argv[i], "-cpu_thermal_divider") == 0){cpu_thermal_divider = atoi(argv[++i]);
             if (cpu_thermal_divider == 0){print_stderr("invalid -cpu_thermal_divider argument, reset to '1', value needs to be over 0\n"); cpu_thermal_divider = 1;}
         } else if (strcmp(argv[i], "-cpu_thermal_celsius") == 0){cputemp_celsius = atoi(argv[++i]) > 0;
+        } else if (strcmp(argv[i], "-shm") == 0){strncpy(shm_metrics_path, argv[++i], PATH_MAX-1);
+
+        //Data sources refresh intervals
+        } else if (strncmp(argv[i], "-refresh_", 9) == 0){
+            int source = -1, interval = atoi(argv[++i]);
+            for (int j=0; j<sampler_count; j++){if (strcmp(argv[i-1] + 9, sampler_sources[j].name) == 0){source = j; break;}}
+            if (source < 0){print_stderr("unknown data source for %s argument, ignored\n", argv[i-1]);
+            } else {
+                if (int_constrain(&interval, 10, 3600000) != 0){print_stderr("invalid %s argument, reset to '%d', allow from '10' to '3600000' (incl.)\n", argv[i-1], interval);}
+                *sampler_sources[source].interval_ms = interval;
+            }
 
         //Program
         } else if (strcmp(argv[i], "-display") == 0){display_number = atoi(argv[++i]);
@@ -1526,7 +2678,19 @@ int main(int argc, char *argv[]){
         } else if (strcmp(argv[i], "-layer") == 0){osd_layer = atoi(argv[++i]);
         } else if (strcmp(argv[i], "-check") == 0){osd_check_rate = atoi(argv[++i]);
             if (int_constrain(&osd_check_rate, 1, 120) != 0){print_stderr("invalid -check argument, reset to '%d', allow from '1' to '120' (incl.)\n", osd_check_rate);}
+        } else if (strcmp(argv[i], "-dispmanx_async") == 0){dispmanx_async = atoi(argv[++i]) > 0;
         } else if (strcmp(argv[i], "-debug") == 0){debug = atoi(argv[++i]) > 0;
+#ifndef NO_CONTROL_SOCKET
+        } else if (strcmp(argv[i], "-ctl_socket") == 0){strncpy(ctl_socket_path, argv[++i], PATH_MAX-1);
+        } else if (strcmp(argv[i], "-ctl_socket_mode") == 0){ctl_socket_mode = (int)strtol(argv[++i], NULL, 8) & 0777;
+#endif
+#ifndef NO_GPIO
+        } else if (strcmp(argv[i], "-gpio_chip") == 0){strncpy(gpio_chip_path, argv[++i], PATH_MAX-1);
+        } else if (strcmp(argv[i], "-gpio_debounce") == 0){gpio_debounce_ms = atoi(argv[++i]);
+            if (int_constrain(&gpio_debounce_ms, 0, 1000) != 0){print_stderr("invalid -gpio_debounce argument, reset to '%d', allow from '0' to '1000' (incl.)\n", gpio_debounce_ms);}
+        } else if (strcmp(argv[i], "-gpio_hold") == 0){gpio_hold_ms = atoi(argv[++i]);
+            if (int_constrain(&gpio_hold_ms, 0, 10000) != 0){print_stderr("invalid -gpio_hold argument, reset to '%d', allow from '0' to '10000' (incl.)\n", gpio_hold_ms);}
+#endif
 #ifdef BUFFER_PNG_EXPORT
         } else if (strcmp(argv[i], "-buffer_png_export") == 0){debug_buffer_png_export = true;
 #endif
@@ -1538,6 +2702,11 @@ int main(int argc, char *argv[]){
         charset_export_png();
     #endif
 
+    //meminfo parser benchmark
+    #ifdef MEMINFO_BENCHMARK
+        meminfo_benchmark();
+    #endif
+
     //pid file
     int pid = (int)getpid();
     if (pid > 0){
@@ -1549,12 +2718,11 @@ int main(int argc, char *argv[]){
         } else {pid_path[0] = '\0';} //failed to write pid file
     }
 
-    //tty signal handling
-    signal(SIGINT, tty_signal_handler); //ctrl-c
-    signal(SIGTERM, tty_signal_handler); //SIGTERM from htop or other, SIGKILL not work as program get killed before able to handle
+    //tty signal handling, SIGINT (ctrl-c), SIGTERM (htop or other), SIGUSR1 (full OSD trigger) and SIGUSR2 (tiny OSD trigger) are blocked and read from signalfd in main loop
+    sigset_t signal_mask; sigemptyset(&signal_mask);
+    sigaddset(&signal_mask, SIGINT); sigaddset(&signal_mask, SIGTERM); sigaddset(&signal_mask, SIGUSR1); sigaddset(&signal_mask, SIGUSR2);
+    if (sigprocmask(SIG_BLOCK, &signal_mask, NULL) != 0 || (signal_fd = signalfd(-1, &signal_mask, SFD_NONBLOCK | SFD_CLOEXEC)) < 0){print_stderr("FATAL: signalfd() failed, errno:%d.\n", errno); return EXIT_FAILURE;}
     signal(SIGABRT, tty_signal_handler); //failure
-    signal(SIGUSR1, tty_signal_handler); //use signal SIGUSR1 as trigger to display full OSD
-    signal(SIGUSR2, tty_signal_handler); //use signal SIGUSR2 as trigger to display tiny OSD
     atexit(program_close); at_quick_exit(program_close); //run on program exit
 
     #ifdef NO_SIGNAL
@@ -1615,6 +2783,32 @@ int main(int argc, char *argv[]){
         }
     }
 
+    //main loop epoll set and periodic timer
+    if ((loop_epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0){print_stderr("FATAL: epoll_create1() failed, errno:%d.\n", errno); return EXIT_FAILURE;}
+    if ((loop_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0){print_stderr("FATAL: timerfd_create() failed, errno:%d.\n", errno); return EXIT_FAILURE;}
+    loop_fd_add(loop_timer_fd, LOOP_SRC_TIMER, 0);
+    loop_fd_add(signal_fd, LOOP_SRC_SIGNAL, 0);
+    if (dispmanx_async){ //async dispmanx update completion
+        if ((dispmanx_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0 || !loop_fd_add(dispmanx_event_fd, LOOP_SRC_DISPMANX, 0)){
+            print_stderr("Failed to init dispmanx update completion eventfd, errno:%d, fall back to synchronous updates.\n", errno);
+            if (dispmanx_event_fd >= 0){close(dispmanx_event_fd); dispmanx_event_fd = -1;}
+            dispmanx_async = false;
+        }
+    }
+
+    //signal file
+    #ifndef NO_SIGNAL_FILE
+        if (signal_path[0] != '\0'){signal_file_init();}
+    #endif
+
+    //power supply uevents
+    if (uevent_enabled && !uevent_init()){print_stderr("power_supply uevents disabled, battery capacity polled every %dms\n", refresh_battery_rsoc_ms);}
+
+    //osd data sampler thread
+    #if !(defined(NO_OSD) && defined(NO_TINYOSD))
+        if (!sampler_thread_start()){print_stderr("FATAL: failed to start sampler thread.\n"); return EXIT_FAILURE;}
+    #endif
+
     #ifndef NO_GPIO
         if (lowbat_gpio > -1 || osd_gpio > -1 || tinyosd_gpio > -1){gpio_init();}
     #endif
@@ -1688,36 +2882,81 @@ int main(int argc, char *argv[]){
         print_stderr("Tiny OSD disabled at compilation time.\n");
     #endif
 
+    //control socket
+    #ifndef NO_CONTROL_SOCKET
+        #ifndef NO_OSD
+            if (osd_resource > 0){ctl_available |= FP_OSD_CTL_STATE_OSD;}
+        #endif
+        #ifndef NO_TINYOSD
+            if (tinyosd_resource > 0){ctl_available |= FP_OSD_CTL_STATE_TINYOSD;}
+        #endif
+        if (ctl_socket_path[0] != '\0'){ctl_init();}
+    #endif
+
+    //input devices
+    #ifndef NO_EVDEV
+        evdev_init();
+    #endif
+
     //main loop
     print_stderr("Starting main loop\n");
 
-    double osd_update_interval = 1. / osd_check_rate;
-    double gpio_check_start_time = -1, sec_check_start_time = -1.; //gpio, seconds interval check start time
+    #if !(defined(NO_OSD) && defined(NO_TINYOSD))
+        double osd_update_interval = 1. / osd_check_rate;
+    #endif
     #if !defined(NO_SIGNAL_FILE) && !(defined(NO_OSD) && defined(NO_TINYOSD))
         bool signal_file_used = false; //signal read from a file
     #endif
-    bool icon_update = false; //warning icon update trigger and second interval reset
+    #if !(defined(NO_BATTERY_ICON) && defined(NO_CPU_ICON))
+        bool icon_update = false; //warning icon update trigger
+    #endif
+    #ifndef NO_BATTERY_ICON
+        bool lowbat_gpio_trigger = false, lowbat_rsoc_trigger = false; //low battery from gpio, from rsoc threshold
+    #endif
+    bool uevent_battery_update = false; //battery capacity updated from power_supply uevent
+    #ifndef NO_GPIO
+        bool gpio_polling = false; //at least one enabled gpio pin not providing edge events, needs periodic check
+        for (int i=0; i<gpio_pins_count; i++){if (gpio_enabled[i] && !gpio_edge_events[i]){gpio_polling = true;}}
+        if (!gpio_polling){sampler_sources[SAMPLER_GPIO].users = 0;} //edge events only, no deadline needed
+    #else
+        sampler_sources[SAMPLER_GPIO].users = 0;
+    #endif
 
+    double loop_stats_start_time = get_time_double(); //wakeups per sec computation start
     while (!kill_requested){ //main loop
         double loop_start_time = get_time_double(); //loop start time
-        dispmanx_update = vc_dispmanx_update_start(0); //start vc update
+        loop_wakeups++;
+        if (debug && loop_start_time - loop_stats_start_time >= loop_stats_interval){ //wakeups and dispmanx updates per sec
+            double loop_stats_duration = loop_start_time - loop_stats_start_time;
+            print_stderr("Main loop: %.2lf wakeups/s, %.2lf dispmanx updates/s (%u submitted, %u skipped) over %.1lfs\n", loop_wakeups / loop_stats_duration, loop_dispmanx_updates / loop_stats_duration, loop_dispmanx_updates, loop_dispmanx_skipped, loop_stats_duration);
+            #ifndef NO_OSD
+                print_stderr("gencmd cache: %u hits, %u misses\n", __atomic_load_n(&gencmd_cache_hits, __ATOMIC_RELAXED), __atomic_load_n(&gencmd_cache_misses, __ATOMIC_RELAXED));
+            #endif
+            #ifndef NO_EVDEV
+                if (evdev_delay_count > 0){print_stderr("EVDEV: %u key events, processing delay avg:%.2lfms, max:%.2lfms\n", evdev_delay_count, evdev_delay_sum / evdev_delay_count * 1000., evdev_delay_max * 1000.);}
+                evdev_delay_sum = evdev_delay_max = 0.; evdev_delay_count = 0;
+            #endif
+            loop_wakeups = loop_dispmanx_updates = loop_dispmanx_skipped = 0; loop_stats_start_time = loop_start_time;
+        }
 
         #ifndef NO_EVDEV
-            if (evdev_enabled){evdev_check(loop_start_time);} //check evdev input, init if needed
+            if (evdev_enabled && evdev_inotify_fd < 0 && evdev_devices_count == 0 && loop_start_time - evdev_scan_time >= evdev_check_interval){evdev_scan(loop_start_time);} //no hotplug events and no input device opened, rescan
         #endif
 
         #ifndef NO_SIGNAL_FILE
-            if (!signal_file_used && osd_start_time < 0. && tinyosd_start_time < 0. && signal_path[0] != '\0' && access(signal_path, R_OK)){ //check signal file value
+            if (signal_file_inotify_fd < 0){signal_file_pending = true;} //no inotify, check on each wakeup
+            if (signal_file_pending && !signal_file_used && osd_start_time < 0. && tinyosd_start_time < 0. && signal_path[0] != '\0'){ //check signal file value once written
+                signal_file_pending = false;
                 int tmp_sig = 0; FILE *filehandle = fopen(signal_path, "r"); if (filehandle != NULL){fscanf(filehandle, "%d", &tmp_sig); fclose(filehandle);}
                 #ifndef NO_OSD
                     if (tmp_sig == SIGUSR1){ //full osd
-                        if (tinyosd_start_time < 0.){osd_start_time = loop_start_time;} else {osd_hold = true;}
+                        osd_trigger(false, loop_start_time, "signal file");
                         signal_file_used = true;
                     } else {
                 #endif
                     #ifndef NO_TINYOSD
                         if (tmp_sig == SIGUSR2){ //tiny osd
-                            if (osd_start_time < 0.){tinyosd_start_time = loop_start_time;} else {tinyosd_hold = true;}
+                            osd_trigger(true, loop_start_time, "signal file");
                             signal_file_used = true;
                         }
                     #endif
@@ -1727,69 +2966,117 @@ int main(int argc, char *argv[]){
             }
         #endif
 
-        if (loop_start_time - gpio_check_start_time > 0.25){ //check gpio 4 times a sec
-            #ifndef NO_GPIO
-                #ifndef NO_OSD
-                    if (osd_start_time < 0. && gpio_check(1)){ //osd gpio trigger
-                        if (tinyosd_start_time < 0.){osd_start_time = loop_start_time;} else {osd_hold = true;}
-                    }
-                #endif
-                #ifndef NO_TINYOSD
-                    if (tinyosd_start_time < 0. && gpio_check(2)){ //tiny osd gpio trigger
-                        if (osd_start_time < 0.){tinyosd_start_time = loop_start_time;} else {tinyosd_hold = true;}
+        #ifndef NO_GPIO
+            if (gpio_polling && sampler_due(SAMPLER_GPIO, loop_start_time)){ //pins without edge events
+                for (int i=0; i<gpio_pins_count; i++){
+                    if (gpio_enabled[i] && !gpio_edge_events[i]){
+                        bool active = gpio_check(i);
+                        if (active != gpio_pending[i]){gpio_edge(i, active != *gpio_reversed[i], loop_start_time);} //any raw level change incl. bounce back, same debounce as edge events
                     }
-                #endif
+                }
+            }
+            #if !(defined(NO_OSD) && defined(NO_TINYOSD))
+                uint8_t gpio_pressed = gpio_update(loop_start_time); //debounced press edges
+            #else
+                gpio_update(loop_start_time); //low battery gpio only
             #endif
+            #ifndef NO_OSD
+                if (gpio_pressed & (1 << 1)){osd_trigger(false, gpio_press_time[1], "gpio");} //osd gpio trigger, latency measured from edge
+                if (osd_start_time > 0. && gpio_held(1, loop_start_time)){osd_start_time = loop_start_time;} //held: keep displayed until release
+            #endif
+            #ifndef NO_TINYOSD
+                if (gpio_pressed & (1 << 2)){osd_trigger(true, gpio_press_time[2], "gpio");} //tiny osd gpio trigger
+                if (tinyosd_start_time > 0. && gpio_held(2, loop_start_time)){tinyosd_start_time = loop_start_time;}
+            #endif
+            #ifndef NO_BATTERY_ICON
+                if (gpio_active[0] != lowbat_gpio_trigger){lowbat_gpio_trigger = gpio_active[0]; icon_update = true;} //low battery gpio, level
+            #endif
+        #endif
 
-            if (loop_start_time - sec_check_start_time > 1.){ //warning trigger every seconds
-                #if !defined(NO_GPIO) && !defined(NO_BATTERY_ICON)
-                    lowbat_trigger = gpio_check(0);
-                #endif
-
-                #ifndef NO_BATTERY_ICON
-                    lowbat_trigger = lowbat_trigger || lowbat_sysfs() || lowbat_test;
-                #elif !(defined(NO_OSD) && defined(NO_TINYOSD))
-                    lowbat_sysfs();
-                #endif
+        //warning icons data
+        shm_metrics_map(loop_start_time); //no-op once mapped
+        if (sampler_due(SAMPLER_BATTERY_RSOC, loop_start_time)){
+            #ifndef NO_BATTERY_ICON
+                lowbat_rsoc_trigger = lowbat_sysfs(); icon_update = true;
+            #elif !(defined(NO_OSD) && defined(NO_TINYOSD))
+                lowbat_sysfs();
+            #endif
+        }
 
-                #ifndef NO_CPU_ICON
-                    cputemp_trigger = cputemp_sysfs() || cputemp_test;
-                #elif !(defined(NO_OSD) && defined(NO_TINYOSD))
-                    cputemp_sysfs();
-                #endif
+        if (sampler_due(SAMPLER_CPU_THERMAL, loop_start_time)){
+            #ifndef NO_CPU_ICON
+                cputemp_trigger = cputemp_sysfs() || cputemp_test; icon_update = true;
+            #elif !(defined(NO_OSD) && defined(NO_TINYOSD))
+                cputemp_sysfs();
+            #endif
+        }
 
-                icon_update = true;
-            }
-            gpio_check_start_time = loop_start_time;
+        if (uevent_battery_update){ //battery capacity from power_supply uevent
+            #ifndef NO_BATTERY_ICON
+                lowbat_rsoc_trigger = battery_rsoc <= lowbat_limit; icon_update = true;
+            #endif
+            uevent_battery_update = false;
         }
 
-        //full osd
+        #ifndef NO_BATTERY_ICON
+            lowbat_trigger = lowbat_gpio_trigger || lowbat_rsoc_trigger || lowbat_test;
+        #endif
+
+        //osd test and hold
         #ifndef NO_OSD
             if (osd_test){osd_start_time = loop_start_time;}
-            if (osd_hold && tinyosd_start_time < 0.){osd_start_time = loop_start_time; osd_hold = false;} //osd was on hold
-            if (osd_resource > 0 && osd_start_time > 0.){
+            if (osd_hold && tinyosd_start_time < 0.){osd_start_time = osd_trigger_time = loop_start_time; osd_hold = false;} //osd was on hold
+        #endif
+        #ifndef NO_TINYOSD
+            if (tinyosd_test){tinyosd_start_time = loop_start_time;}
+            if (tinyosd_hold && osd_start_time < 0.){tinyosd_start_time = tinyosd_trigger_time = loop_start_time; tinyosd_hold = false;} //tiny osd was on hold
+        #endif
+
+        //osd data sources users, sampler thread woken to sample related sources right away if changed
+        #if !(defined(NO_OSD) && defined(NO_TINYOSD))
+            sampler_users_set(sampler_users_active());
+        #endif
+
+        dispmanx_update = 0; //vc update only started on first element change, see dispmanx_update_get()
+        bool dispmanx_ready = !dispmanx_update_pending; //previous async update committed, elements and resources can be modified
+
+        //full osd
+        #ifndef NO_OSD
+            if (osd_resource > 0 && osd_start_time > 0. && dispmanx_ready){
                 if (loop_start_time - osd_start_time > (double)osd_timeout){ //osd timeout
-                    if (osd_element > 0){vc_dispmanx_element_remove(dispmanx_update, osd_element); osd_element = 0;}
+                    if (osd_element > 0){vc_dispmanx_element_remove(dispmanx_update_get(&dispmanx_update), osd_element); osd_element = 0;}
                     #ifndef NO_SIGNAL_FILE
                         if (signal_file_used){FILE *filehandle = fopen(signal_path, "w"); if (filehandle != NULL){fputc('0', filehandle); fclose(filehandle);} signal_file_used = false;}
                     #endif
                     osd_start_time = -1.;
-                } else {osd_build_element(osd_resource, &osd_element, dispmanx_update, osd_width, osd_height, 0, 0, display_width, display_height);}
+                } else {osd_build_element(osd_resource, &osd_element, &dispmanx_update, osd_width, osd_height, 0, 0, display_width, display_height);}
+            }
+            if (osd_trigger_time > 0. && osd_start_time > 0. && osd_element == 0 && dispmanx_ready){ //failed to display (bitmap buffer or dispmanx failure)
+                if (debug){print_stderr("OSD failed to display\n");}
+                osd_trigger_time = osd_start_time = -1.; //nothing displayed, not kept as started
+                #ifndef NO_CONTROL_SOCKET
+                    ctl_displayed(FP_OSD_CTL_SHOW_OSD, -EIO, loop_start_time); //waiting clients would never be replied otherwise
+                #endif
             }
         #endif
 
         //tiny osd
         #ifndef NO_TINYOSD
-            if (tinyosd_test){tinyosd_start_time = loop_start_time;}
-            if (tinyosd_hold && osd_start_time < 0.){tinyosd_start_time = loop_start_time; tinyosd_hold = false;} //tiny osd was on hold
-            if (tinyosd_resource > 0 && tinyosd_start_time > 0.){
+            if (tinyosd_resource > 0 && tinyosd_start_time > 0. && dispmanx_ready){
                 if (loop_start_time - tinyosd_start_time > (double)osd_timeout){ //osd timeout
-                    if (tinyosd_element > 0){vc_dispmanx_element_remove(dispmanx_update, tinyosd_element); tinyosd_element = 0;}
+                    if (tinyosd_element > 0){vc_dispmanx_element_remove(dispmanx_update_get(&dispmanx_update), tinyosd_element); tinyosd_element = 0;}
                     #ifndef NO_SIGNAL_FILE
                         if (signal_file_used){FILE *filehandle = fopen(signal_path, "w"); if (filehandle != NULL){fputc('0', filehandle); fclose(filehandle);} signal_file_used = false;}
                     #endif
                     tinyosd_start_time = -1.;
-                } else {tinyosd_build_element(tinyosd_resource, &tinyosd_element, dispmanx_update, tinyosd_width, tinyosd_height, 0, tinyosd_y, display_width, tinyosd_height_dest);}
+                } else {tinyosd_build_element(tinyosd_resource, &tinyosd_element, &dispmanx_update, tinyosd_width, tinyosd_height, 0, tinyosd_y, display_width, tinyosd_height_dest);}
+            }
+            if (tinyosd_trigger_time > 0. && tinyosd_start_time > 0. && tinyosd_element == 0 && dispmanx_ready){ //failed to display (bitmap buffer or dispmanx failure)
+                if (debug){print_stderr("Tiny OSD failed to display\n");}
+                tinyosd_trigger_time = tinyosd_start_time = -1.; //nothing displayed, not kept as started
+                #ifndef NO_CONTROL_SOCKET
+                    ctl_displayed(FP_OSD_CTL_SHOW_TINYOSD, -EIO, loop_start_time); //waiting clients would never be replied otherwise
+                #endif
             }
         #endif
 
@@ -1800,20 +3087,20 @@ int main(int argc, char *argv[]){
         #endif
 
         #ifndef NO_BATTERY_ICON
-            if (lowbat_resource > 0){ //low battery icon
+            if (lowbat_resource > 0 && dispmanx_ready){ //low battery icon
                 if (lowbat_trigger){
                     if (icon_update){
                         if (battery_rsoc >= 0){ //update dynamic icon
-                            lowbatt_build_element(lowbat_resource, &lowbat_element, dispmanx_update, icons_org_width[icon_index], icons_org_height[icon_index], icons_x[icon_index], icons_dest_rect.y, icons_width[icon_index], icons_height);
+                            lowbatt_build_element(lowbat_resource, &lowbat_element, &dispmanx_update, icons_org_width[icon_index], icons_org_height[icon_index], icons_x[icon_index], icons_dest_rect.y, icons_width[icon_index], icons_height);
                         } else if (!lowbat_displayed && lowbat_element == 0){ //display static icon
                             icons_dest_rect.x = icons_x[icon_index]; icons_dest_rect.width = icons_width[icon_index]; //icon x/width
-                            lowbat_element = vc_dispmanx_element_add(dispmanx_update, dispmanx_display, osd_layer + 2, &icons_dest_rect, lowbat_resource, &lowbat_rect, DISPMANX_PROTECTION_NONE, &dispmanx_alpha_from_src, NULL, DISPMANX_NO_ROTATE);
+                            lowbat_element = vc_dispmanx_element_add(dispmanx_update_get(&dispmanx_update), dispmanx_display, osd_layer + 2, &icons_dest_rect, lowbat_resource, &lowbat_rect, DISPMANX_PROTECTION_NONE, &dispmanx_alpha_from_src, NULL, DISPMANX_NO_ROTATE);
                         }
                         lowbat_displayed = true;
                     }
                     icons_dest_rect.y += icons_height * icons_y_dir; //next icon y position
                 } else if (lowbat_displayed){ //remove icon
-                    if (lowbat_element > 0){vc_dispmanx_element_remove(dispmanx_update, lowbat_element); lowbat_element = 0;}
+                    if (lowbat_element > 0){vc_dispmanx_element_remove(dispmanx_update_get(&dispmanx_update), lowbat_element); lowbat_element = 0;}
                     lowbat_displayed = false;
                 }
             }
@@ -1821,35 +3108,122 @@ int main(int argc, char *argv[]){
         #endif
 
         #ifndef NO_CPU_ICON
-            if (cputemp_resource > 0){ //cpu temp icon
+            if (cputemp_resource > 0 && dispmanx_ready){ //cpu temp icon
                 if (cputemp_trigger){
                     if (icon_update){
-                        cputemp_build_element(cputemp_resource, &cputemp_element, dispmanx_update, icons_org_width[icon_index], icons_org_height[icon_index], icons_x[icon_index], icons_dest_rect.y, icons_width[icon_index], icons_height);
+                        cputemp_build_element(cputemp_resource, &cputemp_element, &dispmanx_update, icons_org_width[icon_index], icons_org_height[icon_index], icons_x[icon_index], icons_dest_rect.y, icons_width[icon_index], icons_height);
                         cputemp_displayed = true;
                     }
                     icons_dest_rect.y += icons_height * icons_y_dir; //next icon y position
                 } else if (cputemp_displayed){ //remove icon
-                    if (cputemp_element > 0){vc_dispmanx_element_remove(dispmanx_update, cputemp_element); cputemp_element = 0;}
+                    if (cputemp_element > 0){vc_dispmanx_element_remove(dispmanx_update_get(&dispmanx_update), cputemp_element); cputemp_element = 0;}
                     cputemp_displayed = false;
                 }
             }
             icon_index++;
         #endif
 
-        if (icon_update){sec_check_start_time = loop_start_time; icon_update = false;} //disable icon update until next loop
+        #if !(defined(NO_BATTERY_ICON) && defined(NO_CPU_ICON))
+            if (dispmanx_ready){icon_update = false;} //disable icon update until next data refresh, kept until async update committed
+        #endif
+
+        if (dispmanx_update != 0){ //push vc update
+            if (dispmanx_async){ //committed by videocore in background, completion wakes main loop
+                if (vc_dispmanx_update_submit(dispmanx_update, dispmanx_update_callback, NULL) == 0){dispmanx_update_pending = true;
+                } else if (debug){print_stderr("vc_dispmanx_update_submit() failed.\n");}
+            } else {vc_dispmanx_update_submit_sync(dispmanx_update);}
+            loop_dispmanx_updates++;
+        } else {loop_dispmanx_skipped++;} //nothing changed, no update to submit
 
-        vc_dispmanx_update_submit_sync(dispmanx_update); //push vc update
+        //trigger to display latency
+        #ifndef NO_OSD
+            if (osd_trigger_time > 0. && osd_element > 0 && !dispmanx_update_pending){
+                double displayed_time = get_time_double();
+                if (debug){print_stderr("OSD displayed %.2lfms after trigger\n", (displayed_time - osd_trigger_time) * 1000.);}
+                osd_trigger_time = -1.;
+                #ifndef NO_CONTROL_SOCKET
+                    ctl_displayed(FP_OSD_CTL_SHOW_OSD, 0, displayed_time); //acknowledge show requests
+                #endif
+            }
+        #endif
+        #ifndef NO_TINYOSD
+            if (tinyosd_trigger_time > 0. && tinyosd_element > 0 && !dispmanx_update_pending){
+                double displayed_time = get_time_double();
+                if (debug){print_stderr("Tiny OSD displayed %.2lfms after trigger\n", (displayed_time - tinyosd_trigger_time) * 1000.);}
+                tinyosd_trigger_time = -1.;
+                #ifndef NO_CONTROL_SOCKET
+                    ctl_displayed(FP_OSD_CTL_SHOW_TINYOSD, 0, displayed_time);
+                #endif
+            }
+        #endif
 
         if (kill_requested){break;} //kill requested
-        
-        double loop_end_time = get_time_double();
-        if (loop_end_time - loop_start_time < osd_update_interval){usleep((useconds_t) ((osd_update_interval - (loop_end_time - loop_start_time)) * 1000000.));} //limit update rate
 
-        /*if (loop_end_time - bench_start_time > 1.){ //benchmark
-            print_stderr("bench(debug) update rate:%lluhz.\n", bench_loop_count);
-            bench_loop_count = 0;
-            bench_start_time = loop_end_time;
-        } else {bench_loop_count++;}*/
+        //timer deadline: earliest data source deadline, osd refresh rate if something displayed
+        double loop_deadline = sampler_next_deadline(sampler_users_always); //osd data sources deadlines handled by sampler thread
+        #if !(defined(NO_OSD) && defined(NO_TINYOSD))
+            if (osd_start_time > 0. || tinyosd_start_time > 0. || osd_hold || tinyosd_hold){
+                double osd_deadline = loop_start_time + osd_update_interval;
+                if (loop_deadline < 0. || osd_deadline < loop_deadline){loop_deadline = osd_deadline;}
+            }
+        #endif
+        #ifndef NO_GPIO
+            double gpio_debounce_deadline = gpio_deadline(); //pending gpio edge
+            if (gpio_debounce_deadline > 0. && (loop_deadline < 0. || gpio_debounce_deadline < loop_deadline)){loop_deadline = gpio_debounce_deadline;}
+        #endif
+        #ifndef NO_EVDEV
+            if (evdev_enabled && evdev_inotify_fd < 0 && evdev_devices_count == 0){ //input device rescan
+                double evdev_deadline = evdev_scan_time + evdev_check_interval;
+                if (loop_deadline < 0. || evdev_deadline < loop_deadline){loop_deadline = evdev_deadline;}
+            }
+        #endif
+        loop_timer_set(loop_deadline);
+
+        //sleep until input, gpio edge, signal or timer
+        struct epoll_event loop_events[loop_events_max];
+        int loop_events_count = epoll_wait(loop_epoll_fd, loop_events, loop_events_max, -1);
+        if (loop_events_count < 0){
+            if (errno == EINTR){continue;} //interrupted by signal not handled by signalfd
+            print_stderr("epoll_wait failed, errno:%d.\n", errno); break;
+        }
+
+        for (int i=0; i<loop_events_count; i++){
+            int loop_event_src = (int)(loop_events[i].data.u64 >> 32);
+            #if !defined(NO_GPIO) || !defined(NO_CONTROL_SOCKET) || !defined(NO_EVDEV)
+                int loop_event_index = (int)(loop_events[i].data.u64 & 0xFFFFFFFF);
+            #endif
+            if (loop_event_src == LOOP_SRC_TIMER){uint64_t expirations; read(loop_timer_fd, &expirations, sizeof(expirations)); //clear timer
+            } else if (loop_event_src == LOOP_SRC_SIGNAL){signal_fd_process(); //triggers and close requests
+            #ifndef NO_SIGNAL_FILE
+            } else if (loop_event_src == LOOP_SRC_SIGNAL_FILE){signal_file_process(); //signal file written
+            #endif
+            #ifndef NO_CONTROL_SOCKET
+            } else if (loop_event_src == LOOP_SRC_CTL_LISTEN){ctl_accept(); //new control socket client
+            } else if (loop_event_src == LOOP_SRC_CTL_CLIENT){ctl_process(loop_event_index, get_time_double()); //control socket requests, receive time as trigger time
+            #endif
+            #ifndef NO_EVDEV
+            } else if (loop_event_src == LOOP_SRC_EVDEV){evdev_process(loop_event_index, get_time_double()); //input device keys, kernel event time as trigger time, read time if not available
+            } else if (loop_event_src == LOOP_SRC_EVDEV_HOTPLUG){evdev_hotplug_process(loop_start_time); //input device arrival or removal
+            #endif
+            #if !(defined(NO_OSD) && defined(NO_TINYOSD))
+            } else if (loop_event_src == LOOP_SRC_SAMPLER){uint64_t publishes; read(sampler_notify_fd, &publishes, sizeof(publishes)); osd_data_snapshot(&osd_data); //new osd data snapshot
+            #endif
+            } else if (loop_event_src == LOOP_SRC_UEVENT){if (uevent_process()){uevent_battery_update = true;} //power supply change events
+            } else if (loop_event_src == LOOP_SRC_DISPMANX){uint64_t completions; read(dispmanx_event_fd, &completions, sizeof(completions)); dispmanx_update_pending = false; //async update committed
+            } else if (loop_event_src == LOOP_SRC_GPIO){ //drain gpio edge events, state read by gpio_check()
+                #ifndef NO_GPIO
+                    if (loop_event_index == gpio_pins_count){gpio_cdev_process(); //gpio character device
+                    } else {
+                        #ifdef USE_GPIOD
+                            struct gpiod_line_event gpiod_event;
+                            while (gpiod_line_event_read_fd(gpiod_fd[loop_event_index], &gpiod_event) == 0){
+                                gpio_edge(loop_event_index, gpiod_event.event_type == GPIOD_LINE_EVENT_RISING_EDGE, gpiod_event.ts.tv_sec + (double)gpiod_event.ts.tv_nsec / 1e9);
+                            }
+                        #endif
+                    }
+                #endif
+            }
+        }
     }
 
     //free vc ressources
@@ -1885,5 +3259,10 @@ int main(int argc, char *argv[]){
         for (int i=0; i<gpio_pins_count; i++){if (gpiod_input_line[i] != NULL){gpiod_line_release(gpiod_input_line[i]);}}
     #endif
 
+    //gpio character device
+    #ifndef NO_GPIO
+        if (gpio_cdev_fd >= 0){close(gpio_cdev_fd);} //release lines
+    #endif
+
     return EXIT_SUCCESS;
 }
@@ -8,6 +8,7 @@ Please refer to fp_osd.c for more informations.
 //#define NO_GPIO 1 //debug
 //#define NO_SIGNAL 1 //debug
 //#define NO_SIGNAL_FILE 1 //debug
+//#define NO_CONTROL_SOCKET 1 //debug
 //#define NO_EVDEV 1 //debug
 //#define BUFFER_PNG_EXPORT 1 //debug
 //#define NO_OSD 1 //debug
@@ -24,6 +25,23 @@ Please refer to fp_osd.c for more informations.
 #include <stdio.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/timex.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <linux/netlink.h>
+#include <linux/genetlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/nl80211.h>
+#include <poll.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/wait.h>
+extern char **environ; //posix_spawn() environment
 
 #include <png.h>
 #include "bcm_host.h"
@@ -37,12 +55,18 @@ Please refer to fp_osd.c for more informations.
     #define NO_EVDEV 1
     #define NO_SIGNAL 1
     #define NO_SIGNAL_FILE 1
+    #define NO_CONTROL_SOCKET 1
+#endif
+#ifndef NO_CONTROL_SOCKET
+    #include "fp_osd_ctl.h" //control socket protocol
 #endif
 #ifndef NO_EVDEV
     #include <linux/input.h>
     #include <dirent.h>
+    #include <sys/utsname.h>
 #endif
 
+#include "fp_osd_shm.h" //shared memory metrics struct
 #include "settings.h" //user settings vars
 
 #if defined(NO_BATTERY_ICON) && defined(NO_CPU_ICON) && defined(NO_OSD) && defined(NO_TINYOSD)
@@ -56,6 +80,8 @@ Please refer to fp_osd.c for more informations.
 //gpio library
 #ifndef NO_GPIO
     #define gpio_pins_count 3 //amount of pins to monitor
+    #include <linux/gpio.h> //gpio character device uapi v2, used when no gpio library available or library failed
+    #include <sys/ioctl.h>
     #if defined(USE_WIRINGPI) && defined(USE_GPIOD) 
         #error "Only one kind of gpio library allowed at once, please refer to README.md for more informations."
     #elif defined(USE_WIRINGPI)
@@ -74,6 +100,10 @@ Please refer to fp_osd.c for more informations.
 
 //prototypes
 static double get_time_double(void); //get time in double (seconds), takes around 82 microseconds to run
+#if !defined(NO_GPIO) || !(defined(NO_OSD) && defined(NO_TINYOSD))
+    static FILE* command_popen(const char* /*command*/, pid_t* /*pid*/); //popen() equivalent, child gets an empty signal mask instead of signals blocked for signalfd, return NULL on failure
+    static void command_pclose(FILE* /*filehandle*/, pid_t /*pid*/); //pclose() equivalent for command_popen()
+#endif
 
 //static void raspidmx_setPixelRGBA32(void* /*buffer*/, int /*buffer_width*/, int32_t /*x*/, int32_t /*y*/, uint32_t /*color*/); //modified version from Raspidmx
 static int32_t raspidmx_drawCharRGBA32(void* /*buffer*/, int /*buffer_width*/, int /*buffer_height*/, int32_t /*x*/, int32_t /*y*/, uint8_t /*c*/, uint8_t* /*font_ptr*/, uint32_t /*color*/); //modified version from Raspidmx, return end position of printed char
@@ -90,26 +120,143 @@ static uint32_t buffer_getcolor_rgba(void* /*buffer*/, uint32_t /*width*/, uint3
 #endif
 
 static DISPMANX_RESOURCE_HANDLE_T dispmanx_resource_create_from_png(char* /*filename*/, VC_RECT_T* /*image_rect_ptr*/); //create dispmanx ressource from png file, return 0 on failure, ressource handle on success
+static DISPMANX_UPDATE_HANDLE_T dispmanx_update_get(DISPMANX_UPDATE_HANDLE_T* /*update*/); //start vc update on first element change of current loop, return update handle
+static void dispmanx_update_callback(DISPMANX_UPDATE_HANDLE_T /*update*/, void* /*arg*/); //async update completion, called from videocore thread, wake main loop
 
 #ifndef NO_GPIO
     static void gpio_init(void); //init gpio things
     static bool gpio_check(int /*index*/); //check if gpio pin state
+    static bool gpio_cdev_init(void); //request all enabled pins from gpio character device as one line request with both edges events and kernel debounce, return false on failure
+    static void gpio_cdev_process(void); //drain gpio character device edge events, update pins state
+    static void gpio_edge(int /*index*/, bool /*level*/, double /*time*/); //raw level change from edge event or polling, time in monotonic sec, accepted by gpio_update() once stable for debounce period
+    static uint8_t gpio_update(double /*now*/); //accept debounced pins state, return bitmask of pins pressed since last call
+    static double gpio_deadline(void); //earliest debounce period end, -1 if none pending
+    #if !(defined(NO_OSD) && defined(NO_TINYOSD))
+        static bool gpio_held(int /*index*/, double /*now*/); //pin active for at least hold duration
+    #endif
+#endif
+
+typedef struct sysfs_attr_s sysfs_attr_t; //sysfs attribute, defined with sysfs vars
+static int sysfs_attr_read(sysfs_attr_t* /*attr*/, char* /*buffer*/, int /*size*/); //read attribute content from start using pread(), open on first use, reopen if device gone or file emptied, return length or -1 on failure
+static void sysfs_attr_close(sysfs_attr_t* /*attr*/); //close attribute fd, reopened on next read
+static bool sysfs_attr_read_int(sysfs_attr_t* /*attr*/, int32_t* /*value*/); //read attribute as integer, return false on failure
+#if !(defined(NO_OSD) && defined(NO_TINYOSD))
+    static bool sysfs_attr_read_double(sysfs_attr_t* /*attr*/, double* /*value*/); //read attribute as decimal number, return false on failure
+#endif
+
+static bool uevent_init(void); //open kernel uevent netlink socket (or test unix socket), return false on failure
+static bool uevent_process(void); //read pending uevents, update battery data from power_supply change events, return true if battery capacity updated
+
+#ifndef NO_SIGNAL_FILE
+    static bool signal_file_init(void); //inotify instance watching signal file, return false on failure
+    static void signal_file_watch(void); //(re)watch signal file, its parent directory if file doesn't exist yet
+    static void signal_file_process(void); //read inotify events, flag signal file to be read if written, rewatch if created, deleted or replaced
 #endif
 
-static bool lowbat_sysfs(void); //read sysfs power_supply battery capacity, return true if threshold, false if under or file not found
+static void shm_metrics_map(double /*now*/); //map shared memory metrics file if not mapped yet and retry delay expired
+static bool shm_metrics_read(fp_osd_shm_t* /*dest*/); //consistent copy of shared memory metrics, no syscall, return false if not mapped or invalid
+
+static bool lowbat_sysfs(void); //read battery capacity from shared memory metrics or sysfs power_supply, return true if threshold, false if under or file not found
 static bool cputemp_sysfs(void); //read sysfs cpu temperature, return true if threshold, false if under or file not found
 
+static bool sampler_due(int /*index*/, double /*now*/); //check if data source deadline expired, schedule next deadline if so
+static double sampler_next_deadline(uint8_t /*users*/); //earliest deadline of data sources needed by given users, -1 if none
+
+#if !(defined(NO_OSD) && defined(NO_TINYOSD))
+    static bool sampler_run(double /*now*/, uint8_t /*users*/); //sample all data sources with a sampling function needed by given users and expired deadline, return true if any sampled
+    static uint8_t sampler_users_active(void); //data sources users currently active
+    typedef struct osd_data_s osd_data_t; //osd data snapshot, defined with osd data vars
+    static void* sampler_thread(void* /*arg*/); //sample osd data sources on their deadlines, publish snapshot to main loop
+    static bool sampler_thread_start(void); //create eventfds and start sampler thread, return false on failure
+    static void sampler_thread_stop_join(void); //request sampler thread close and wait for it
+    static void sampler_users_set(uint8_t /*users*/); //main thread: update data sources users, wake sampler thread if changed
+    static void sampler_thread_wake(void); //wake sampler thread
+    static void osd_data_publish(void); //sampler thread: copy working data to shared snapshot, seqlock write side
+    static void osd_data_snapshot(osd_data_t* /*dest*/); //main thread: consistent copy of shared snapshot, seqlock read side
+    static uint32_t uptime_get(void); //system uptime in sec
+    static void battery_voltage_sample(void); //read battery voltage file
+    static void cpu_load_sample(void); //sample /proc/stat through persistent fd without blocking, update cpu load from delta with previous sample
+    static void backlight_sample(void); //backlight current and maximum value from shared memory metrics, files otherwise
+    static void network_sample(void); //interfaces ipv4 addresses, wifi link speed and signal
+    typedef struct wifi_cache_s wifi_cache_t; //per interface wireless cache, defined with osd data vars
+    typedef struct osd_network_data_s osd_network_data_t; //interfaces data, defined with osd data vars
+    typedef struct network_table_s network_table_t; //interfaces table entry, defined with osd data vars
+    static bool rtnl_init(void); //open rtnetlink socket subscribed to link and ipv4 address changes, dump current interfaces, return false on failure
+    static bool rtnl_dump(void); //rebuild interfaces table from link and ipv4 address dumps, return false if events were lost meanwhile
+    static int rtnl_process_messages(int /*flags*/, bool* /*changed*/); //receive one netlink datagram and update interfaces table, return 0 on end of dump, -1 on failure or nothing pending, -2 if socket buffer overflowed (events lost), 1 otherwise
+    static bool rtnl_process(void); //read all pending rtnetlink events, return true if interfaces table changed
+    static network_table_t* network_table_get(int /*index*/, bool /*create*/); //interfaces table entry from interface index, created if needed and allowed, NULL otherwise
+    static void network_table_print(const char* /*reason*/); //debug output of interfaces table
+    static void network_table_to_data(osd_network_data_t* /*network_data*/); //non loopback interfaces with ipv4 address from interfaces table, wifi values from cache, no syscall
+    static wifi_cache_t* wifi_cache_get(const char* /*name*/); //per interface wireless cache entry, created if needed, NULL if cache full
+    static bool wifi_proc_wireless_read(osd_network_data_t* /*network_data*/); //signal level from /proc/net/wireless for listed interfaces, return false if file not available
+    static int nl80211_send(uint16_t /*type*/, uint16_t /*flags*/, uint8_t /*cmd*/, uint16_t /*attr_type*/, const void* /*attr_data*/, uint16_t /*attr_len*/); //send generic netlink request with a single attribute, return sequence number or -1 on failure
+    static void nla_parse_flat(struct nlattr** /*attrs*/, int /*max*/, void* /*data*/, int /*len*/); //index attributes by type, nested attributes not parsed
+    static int nl80211_init(void); //open generic netlink socket and resolve nl80211 family id, return id or -1 if not available
+    static int nl80211_station_get(int /*ifindex*/, int* /*speed*/, int* /*signal*/); //first station of interface (access point in managed mode), rx bitrate in Mbit/s, signal in -dBm if not set yet, return 1 if found, 0 if not connected, -1 if not wireless, -2 on failure
+    static void time_sync_sample(void); //check if rtc module installed or system time synchronized with ntc service
+#endif
+#ifndef NO_OSD
+    typedef struct meminfo_s meminfo_t; //meminfo fields, defined with osd data vars
+    static bool meminfo_read(meminfo_t* /*meminfo*/); //single pread of /proc/meminfo, exact key match in one pass, stop once all fields found, fields in kB, -1 if not found, return false on failure
+    #ifdef MEMINFO_BENCHMARK
+        static void meminfo_benchmark(void); //compare meminfo_read() against previous fopen/fgets/strstr loop
+    #endif
+    static void memory_sample(void); //ram and swap usage from /proc/meminfo
+    static int gencmd_vc(char* /*response*/, int /*len*/, const char* /*cmd*/); //videocore gencmd provider, return 0 on success
+    static int gencmd_stub(char* /*response*/, int /*len*/, const char* /*cmd*/); //test gencmd provider, response from 'command:response' line of gencmd_stub_path file, return 0 on success
+    static const char* gencmd_cached(int /*index*/, double /*now*/); //gencmd response from cache, query provider if expired, NULL if never succeeded
+    static void gpu_memory_sample(void); //gpu memory usage from videocore
+    static void shm_sample(void); //gamepad status and custom values from shared memory metrics
+    static void throttled_sample(void); //videocore undervoltage and throttling flags
+#endif
+
 static int int_constrain(int* /*val*/, int /*min*/, int /*max*/); //limit int value to given (incl) min and max value, return 0 if val within min and max, -1 under min, 1 over max
 static bool html_to_uint32_color(char* /*html_color*/, uint32_t* /*rgba*/); //convert html color (3/4 or 6/8 hex) to uint32_t (alpha, blue, green, red)
 
+static void loop_timer_set(double /*deadline*/); //(re)arm main loop timer to given absolute monotonic deadline in sec if changed
+static bool loop_fd_add(int /*fd*/, int /*source*/, int /*index*/); //register fd into main loop epoll set, return false on failure
+#if !defined(NO_EVDEV) || !defined(NO_CONTROL_SOCKET) || (defined(USE_GPIOD) && !defined(NO_GPIO))
+    static void loop_fd_remove(int /*fd*/); //unregister fd from main loop epoll set
+#endif
+
+#if !(defined(NO_OSD) && defined(NO_TINYOSD))
+    static void osd_trigger(bool /*tiny*/, double /*trigger_time*/, const char* /*source*/); //display full or tiny osd, put on hold if other one already displayed
+    static void osd_hide(double /*now*/, const char* /*source*/); //hide displayed osd, cancel held and pending ones
+#endif
+#ifndef NO_CONTROL_SOCKET
+    static bool ctl_init(void); //bind control socket, return false on failure
+    static void ctl_accept(void); //accept pending control socket clients
+    static void ctl_process(int /*slot*/, double /*now*/); //handle client requests, close client on disconnect
+    static void ctl_reply(int /*slot*/, const fp_osd_ctl_request_t* /*request*/, int /*status*/, double /*time*/); //send reply to client
+    static void ctl_displayed(uint8_t /*cmd*/, int /*status*/, double /*time*/); //reply to clients waiting for given show command
+    static void ctl_client_close(int /*slot*/); //close client connection
+#endif
+static void signal_fd_process(void); //read all pending signals from signalfd, repeated triggers coalesced into one
 static void tty_signal_handler(int /*sig*/); //handle signal func
 static void program_close(void); //regroup all close functs
 static void program_get_path(char** /*args*/, char* /*path*/, char* /*program*/); //get current program path based on program argv or getcwd if failed
 static void program_usage(void); //display help
 
 #ifndef NO_EVDEV
-    static int in_array_int(int* /*arr*/, int /*value*/, int /*arr_size*/); //search in value in int array, return index or -1 on failure
-    static void evdev_check(double /*loop_start_time*/); //evdev input check
+    static int evdev_combos_parse(char* /*sequences_char*/, uint8_t /*action*/); //parse trigger sequences separated by ';' character, keycodes separated by '+' (held simultaneously) or ',' (pressed within detection interval), int or hex values, return sequences count
+    static void evdev_init(void); //parse trigger sequences and device names list, scan for input devices
+    typedef struct evdev_info_s evdev_info_t; //device index entry, defined with evdev vars
+    static int evdev_sysfs_read(const char* /*node*/, const char* /*attr_name*/, char* /*buffer*/, int /*size*/); //read input class attribute of event device, trailing newline removed, return length or -1 on failure
+    static evdev_info_t* evdev_index_get(const char* /*node*/); //device index entry of event device, built from sysfs on first use, NULL if not available
+    static void evdev_index_remove(const char* /*node*/); //drop device index entry, node may be reused by another device
+    static bool evdev_info_from_fd(int /*fd*/, evdev_info_t* /*info*/); //device infos from opened event device, used if not indexed, return false on failure
+    static bool evdev_info_match(const evdev_info_t* /*info*/); //device in names list (name, id:vendor:product or phys:), or reporting all keys of a trigger sequence
+    static bool evdev_device_open(const char* /*path*/, bool /*force*/); //open input device if matching (or forced) and not already opened, matched from device index without opening node if indexed, register into main loop, return true if opened
+    static void evdev_device_close(int /*slot*/); //unregister and close input device
+    static void evdev_scan(double /*now*/); //open all matching input devices not opened yet, list devices if no filter set
+    static bool evdev_hotplug_init(void); //inotify instance watching input devices folder, return false on failure
+    static void evdev_hotplug_process(double /*now*/); //read inotify events, open created devices, close removed ones, periodic rescan fallback if folder gone
+    static void evdev_process(int /*slot*/, double /*now*/); //read pending events of input device, feed trigger sequences detection with kernel event time, close device if gone
+    static bool evdev_key_state(int /*slot*/, int /*code*/, bool /*pressed*/); //update keys held by input device and by any device, rearm held sequences using released key, return false if state unchanged
+    static void evdev_keys_sync(int /*slot*/, bool /*release*/); //resync keys held by input device from kernel state, release all of them instead if requested, no sequence triggered
+    static void evdev_key(int /*slot*/, int /*code*/, int /*value*/, double /*now*/); //key event from input device, check sequences using pressed key
+    static void evdev_action(uint8_t /*action*/, double /*now*/); //run action of detected trigger sequence
 #endif
 
 
@@ -130,13 +277,110 @@ double program_start_time = .0; //used for print output
 #if !(defined(NO_OSD) && defined(NO_TINYOSD))
     double osd_start_time = -1., tinyosd_start_time = -1.; //osd start time
     bool osd_hold = false, tinyosd_hold = false; //one kind already displayed but other has to be displayed as well
+    double osd_trigger_time = -1., tinyosd_trigger_time = -1.; //trigger time of osd not yet displayed, used to measure trigger to display latency
 #endif
 
-//evdev thread specific
+//main loop
+enum loop_src_t {LOOP_SRC_TIMER = 0, LOOP_SRC_SIGNAL, LOOP_SRC_DISPMANX, LOOP_SRC_SAMPLER, LOOP_SRC_UEVENT, LOOP_SRC_EVDEV, LOOP_SRC_GPIO, LOOP_SRC_SIGNAL_FILE, LOOP_SRC_CTL_LISTEN, LOOP_SRC_CTL_CLIENT, LOOP_SRC_EVDEV_HOTPLUG}; //epoll event sources, stored in upper part of epoll_data
+#define loop_events_max 16 //maximum events handled per main loop wakeup
+int loop_epoll_fd = -1, loop_timer_fd = -1; //main loop epoll set and deadline timer fd
+double loop_timer_deadline = -1.; //current timer deadline
+int dispmanx_event_fd = -1; //async dispmanx update completion eventfd, written by dispmanx_update_callback()
+bool dispmanx_update_pending = false; //async dispmanx update submitted, not committed yet
+#define loop_stats_interval 10. //wakeups and dispmanx updates debug output interval in sec
+uint32_t loop_wakeups = 0, loop_dispmanx_updates = 0, loop_dispmanx_skipped = 0; //main loop wakeups, dispmanx updates submitted, skipped (nothing changed) since last debug output
+int signal_fd = -1; //SIGUSR1, SIGUSR2, SIGTERM and SIGINT delivered through signalfd
+
+//evdev
 #ifndef NO_EVDEV
-    int evdev_fd = -1;
     bool evdev_enabled = true; //event detection still enabled, defined during runtime
-    char evdev_path_used[PATH_MAX] = ""; //event device path used, done that way to allow disconnect and reconnect of controller without failing evdev routine
+    #define evdev_bits_per_long (8 * (int)sizeof(unsigned long))
+    #define evdev_key_longs (KEY_MAX / evdev_bits_per_long + 1)
+    #define evdev_devices_max 8 //simultaneously opened input devices
+    typedef struct evdev_device_s {
+        int fd; //-1 if slot free
+        dev_t rdev; ino_t ino; //device node, avoid opening same device twice
+        char path[PATH_MAX], name[256];
+        unsigned long keys[evdev_key_longs]; //sequences keys held on this device, released on close
+        bool monotonic; //EVIOCSCLOCKID accepted, event timestamps use CLOCK_MONOTONIC
+    } evdev_device_t;
+    evdev_device_t evdev_devices[evdev_devices_max] = {[0 ... evdev_devices_max-1] = {.fd = -1}}; //opened input devices, epoll index is slot
+    int evdev_devices_count = 0; double evdev_scan_time = -1.; //opened devices, last scan time
+    int evdev_inotify_fd = -1; //input devices folder watch, devices opened on arrival, -1 if not available (periodic rescan while no device opened)
+    char evdev_watch_name[NAME_MAX+1] = {'\0'}; //device file name if -evdev_path is a device, empty to accept any event device
+    #define evdev_names_max 8 //device names list limit
+    char evdev_names[evdev_names_max][256]; int evdev_names_count = 0; //device names list, one per -evdev_device argument, evdev_name_search otherwise
+
+    typedef struct evdev_info_s {
+        char node[NAME_MAX+1]; //event device file name, empty if index entry free
+        char name[256], phys[64]; //device name, physical path
+        uint16_t vendor, product; //device id
+        unsigned long key_bits[evdev_key_longs]; //reported keys
+    } evdev_info_t;
+    #define evdev_index_max 32 //indexed devices limit, devices not indexed are matched by opening their node
+    evdev_info_t evdev_index[evdev_index_max] = {0}; //device index built from sysfs, entry kept until device removal
+    unsigned long evdev_key_mask[evdev_key_longs] = {0}; //keycodes used by trigger sequences, EVIOCSMASK filter
+
+    //trigger sequences, shared by all devices, keys bitsets compared to pressed keys bitsets
+    enum evdev_action_t {EVDEV_ACTION_OSD, EVDEV_ACTION_TINYOSD, EVDEV_ACTION_HIDE, EVDEV_ACTIONS_COUNT}; //actions run by trigger sequences, see evdev_action()
+    const char *evdev_action_names[EVDEV_ACTIONS_COUNT] = {"OSD", "Tiny OSD", "Hide OSD"};
+    #define evdev_combos_max 64 //trigger sequences limit (all actions together)
+    #define evdev_combo_longs ((evdev_combos_max + evdev_bits_per_long - 1) / evdev_bits_per_long) //sequences bitset size
+    typedef struct evdev_combo_s {
+        uint8_t action; //evdev_action_t
+        bool held; //all keys held simultaneously ('+' separated), pressed within detection interval otherwise (',' separated)
+        bool armed; //held sequence not triggered since one of its keys release
+        int word_first, word_last; //keys bitset words range containing keys
+        unsigned long keys[evdev_key_longs]; //keys bitset
+    } evdev_combo_t;
+    evdev_combo_t evdev_combos[evdev_combos_max]; int evdev_combos_count = 0; //parsed trigger sequences
+    unsigned long evdev_key_combos[KEY_MAX + 1][evdev_combo_longs] = {{0}}; //bitset of sequences using each keycode
+    unsigned long evdev_pressed[evdev_key_longs] = {0}, evdev_recent[evdev_key_longs] = {0}; //keys held on any device, keys pressed within detection interval
+    uint8_t evdev_key_holders[KEY_MAX + 1] = {0}; //devices holding each keycode
+    double evdev_key_press_time[KEY_MAX + 1] = {0}; //last press time of each keycode
+    double evdev_sequence_detect_interval = 0.2; //max interval between first and last input detected in seconds, compared to kernel event time
+    double evdev_delay_sum = 0., evdev_delay_max = 0.; uint32_t evdev_delay_count = 0; //key events processing delay (read time minus event time) since last debug output
+#endif
+
+//signal file
+#ifndef NO_SIGNAL_FILE
+    int signal_file_inotify_fd = -1, signal_file_wd = -1; //inotify instance and current watch descriptor
+    bool signal_file_dir_watched = false; //parent directory watched as signal file doesn't exist yet
+    char signal_file_name[NAME_MAX+1] = {'\0'}; //signal file name in parent directory events
+    bool signal_file_pending = true; //signal file written since last read, true to read initial value
+#endif
+
+//control socket
+#ifndef NO_CONTROL_SOCKET
+    #define ctl_clients_max 8 //simultaneous control socket clients
+    int ctl_listen_fd = -1; //listening socket
+    int ctl_client_fd[ctl_clients_max] = {-1, -1, -1, -1, -1, -1, -1, -1}; //connected clients, -1 if slot free
+    fp_osd_ctl_request_t ctl_client_request[ctl_clients_max]; bool ctl_client_waiting[ctl_clients_max] = {0}; //show request replied once osd displayed
+    uint8_t ctl_available = 0; //FP_OSD_CTL_STATE_OSD/TINYOSD bitmask of osd kinds with valid dispmanx resource, defined during runtime
+#endif
+
+//power supply uevents
+#define uevent_buffer_size 8192 //uevent datagram max size
+int uevent_fd = -1; //kernel uevent netlink socket or test unix socket
+char uevent_battery_name[64] = {'\0'}; //power supply name extracted from battery_rsoc_path, empty to accept any
+bool uevent_received = false; //power_supply capacity uevent received at least once, battery capacity polling slowed down
+#if !(defined(NO_OSD) && defined(NO_TINYOSD))
+    int32_t uevent_battery_voltage_raw = -1; //voltage from last uevent not yet consumed by sampler thread, -1 if none
+#endif
+
+//shared memory metrics
+fp_osd_shm_t *shm_metrics_ptr = NULL; //read-only mapping, set by main thread, read by both threads, kept until program close, NULL if not mapped
+double shm_metrics_retry_time = 0.; //next mapping attempt
+#define shm_metrics_retry_interval 5. //mapping retry interval in sec while file doesn't exist
+
+//sysfs attributes, opened once and re-read with pread()
+typedef struct sysfs_attr_s {
+    const char* path; //settings.h path var, empty to disable
+    int fd; //-1 if not opened
+} sysfs_attr_t;
+sysfs_attr_t battery_rsoc_attr = {battery_rsoc_path, -1}, battery_volt_attr = {battery_volt_path, -1}, cpu_thermal_attr = {cpu_thermal_path, -1};
+#if !(defined(NO_OSD) && defined(NO_TINYOSD))
+    sysfs_attr_t backlight_attr = {backlight_path, -1}, backlight_max_attr = {backlight_max_path, -1};
 #endif
 
 //cpu data
@@ -145,6 +389,120 @@ int32_t cputemp_curr = -1, cputemp_disp = -1, cputemp_last = -2; //current cpu t
     uint32_t cputemp_icon_bg_color = 0xFF000000;
 #endif
 
+//osd data, refreshed by data sources and read by osd builders
+#if !(defined(NO_OSD) && defined(NO_TINYOSD))
+    #define network_data_limit 10
+    typedef struct osd_network_data_s {
+        uint8_t count;
+        struct osd_if_struct {char name[IF_NAMESIZE]; char ipv4[16]; /*char ipv6[40];*/ int speed, signal; bool up;} interface[network_data_limit];
+    } osd_network_data_t;
+
+    #define network_table_limit 32
+    #define network_table_ipv4_limit 4
+    typedef struct network_table_s {
+        int index; char name[IF_NAMESIZE]; //interface
+        bool up, loopback; //link flags
+        char ipv4[network_table_ipv4_limit][16]; uint8_t ipv4_count; //ipv4 addresses in order added, first one displayed
+    } network_table_t;
+    network_table_t network_table[network_table_limit]; int network_table_count = 0; //interfaces table maintained from rtnetlink events, sampler thread only
+    int rtnl_fd = -1; //rtnetlink socket, -1 if not available (getifaddrs() fallback)
+
+    typedef struct wifi_cache_s {
+        char name[IF_NAMESIZE]; int ifindex; //interface
+        int8_t wireless; //-1 unknown, 0 not wireless (never queried again), 1 wireless
+        int speed, signal; //last values
+    } wifi_cache_t;
+    wifi_cache_t wifi_cache[network_data_limit] = {0}; int wifi_cache_count = 0; //sampler thread only
+    sysfs_attr_t wireless_attr = {"/proc/net/wireless", -1}; //wireless extensions signal level
+    sysfs_attr_t proc_stat_attr = {"/proc/stat", -1}; //cpu load, first line only
+    int nl80211_fd = -1, nl80211_family_id = 0; uint32_t nl80211_seq = 0; //generic netlink socket, nl80211 family id (0 unresolved, -1 not available), request sequence
+
+    typedef struct osd_data_s {
+        uint32_t version; //incremented on each publish, osd builders redraw when changed
+        double battery_voltage; //volts, -1 if invalid
+        int32_t cpu_load; //percent, -1 until two /proc/stat samples available
+        int32_t memory_total, memory_used, swap_total, swap_used; //ram and swap in mB, used -1 if invalid
+        int32_t gpu_memory_total, gpu_memory_used; //gpu memory in mB
+        int32_t throttled; //get_throttled flags, -1 if invalid
+        int32_t backlight, backlight_max; //backlight current and maximum value, -1 if invalid
+        int32_t gamepad_status; //FP_OSD_SHM_GAMEPAD_* bitmask, -1 if invalid
+        uint32_t custom_valid; int32_t custom[fp_osd_shm_custom_count]; char custom_label[fp_osd_shm_custom_count][fp_osd_shm_label_size]; //shared memory custom values, FP_OSD_SHM_VALID_CUSTOM() bitmask
+        osd_network_data_t network; //interfaces
+        bool time_rtc, time_ntc; //rtc module installed, time synchronized with ntc
+    } osd_data_t;
+    #define time_sync_maxerror_limit 16000000 //adjtimex() maximum error in us below which clock is considered synchronized, same limit as kernel STA_UNSYNC and systemd
+    #define osd_data_init {.battery_voltage = -1., .cpu_load = -1, .memory_used = -1, .swap_used = -1, .gpu_memory_used = -1, .throttled = -1, .backlight = -1, .backlight_max = -1, .gamepad_status = -1}
+
+    osd_data_t sampler_data = osd_data_init; //sampler thread working copy, only accessed by sampler thread
+    osd_data_t osd_data_shared = osd_data_init; //latest published snapshot, protected by osd_data_seq seqlock
+    osd_data_t osd_data = osd_data_init; //main thread copy of latest snapshot, read by osd builders
+    uint32_t osd_data_seq = 0; //seqlock sequence, odd while sampler thread publishes
+
+    pthread_t sampler_thread_handle; bool sampler_thread_started = false; //sampler thread
+    int sampler_wake_fd = -1, sampler_notify_fd = -1; //eventfds: wake sampler thread (users changed, close request), notify main loop (snapshot published)
+    uint8_t sampler_users = 0; //data sources users currently active, written by main thread, read by sampler thread
+    bool sampler_thread_stop = false; //sampler thread close request
+#endif
+
+//meminfo data
+#ifndef NO_OSD
+    typedef struct meminfo_s {int32_t mem_total, mem_free, mem_available, buffers, cached, swap_total, swap_free;} meminfo_t; //in kB, -1 if not found
+    sysfs_attr_t meminfo_attr = {"/proc/meminfo", -1};
+#endif
+
+//videocore gencmd cache, sampler thread only
+#ifndef NO_OSD
+    typedef struct gencmd_cache_s {
+        const char* cmd; //gencmd command
+        int ttl_ms; //response time to live in millisec, -1 to keep first valid response
+        double time; //last successful query time, -1 if never succeeded
+        char response[128];
+    } gencmd_cache_t;
+    enum gencmd_cache_id_t {GENCMD_MALLOC_TOTAL = 0, GENCMD_RELOC_TOTAL, GENCMD_MALLOC, GENCMD_RELOC, GENCMD_THROTTLED};
+    gencmd_cache_t gencmd_cache[] = { //order needs to follow gencmd_cache_id_t
+        {"get_mem malloc_total", -1, -1.}, //totals don't change at runtime
+        {"get_mem reloc_total", -1, -1.},
+        {"get_mem malloc", 10000, -1.}, //free memory, slower than gpu_memory refresh
+        {"get_mem reloc", 10000, -1.},
+        {"get_throttled", 1000, -1.},
+    };
+    uint32_t gencmd_cache_hits = 0, gencmd_cache_misses = 0; //read by main thread for debug output
+    int (*gencmd_provider)(char*, int, const char*) = gencmd_vc; //gencmd_stub if -gencmd_stub argument set
+#endif
+
+//data sources, each one only sampled when its deadline expires
+#define sampler_users_always 0x1 //needed even without osd displayed (warning icons)
+#define sampler_users_osd 0x2 //needed by full osd
+#define sampler_users_tinyosd 0x4 //needed by tiny osd
+enum sampler_src_t {SAMPLER_GPIO = 0, SAMPLER_BATTERY_RSOC, SAMPLER_CPU_THERMAL}; //sources handled by main loop, others have a sampling function
+typedef struct {
+    const char* name; //used for -refresh_<name> argument
+    int* interval_ms; //refresh interval in millisec, points to settings.h variable
+    uint8_t users; //sampler_users_* bitmask
+    void (*sample)(void); //sampling function, NULL if handled by main loop using sampler_due()
+    double deadline; //next sampling deadline (monotonic)
+} sampler_source_t;
+
+sampler_source_t sampler_sources[] = {
+    {"gpio", &refresh_gpio_ms, sampler_users_always, NULL},
+    {"battery_rsoc", &refresh_battery_rsoc_ms, sampler_users_always, NULL},
+    {"cpu_thermal", &refresh_cpu_thermal_ms, sampler_users_always, NULL},
+#if !(defined(NO_OSD) && defined(NO_TINYOSD))
+    {"battery_voltage", &refresh_battery_voltage_ms, sampler_users_osd | sampler_users_tinyosd, battery_voltage_sample},
+    {"cpu_load", &refresh_cpu_load_ms, sampler_users_osd | sampler_users_tinyosd, cpu_load_sample},
+    {"backlight", &refresh_backlight_ms, sampler_users_osd | sampler_users_tinyosd, backlight_sample},
+    {"network", &refresh_network_ms, sampler_users_osd | sampler_users_tinyosd, network_sample},
+    {"time_sync", &refresh_time_sync_ms, sampler_users_osd | sampler_users_tinyosd, time_sync_sample},
+#endif
+#ifndef NO_OSD
+    {"memory", &refresh_memory_ms, sampler_users_osd, memory_sample},
+    {"gpu_memory", &refresh_gpu_memory_ms, sampler_users_osd, gpu_memory_sample},
+    {"throttled", &refresh_throttled_ms, sampler_users_osd, throttled_sample},
+    {"shm", &refresh_shm_ms, sampler_users_osd, shm_sample},
+#endif
+};
+#define sampler_count (int)(sizeof(sampler_sources) / sizeof(sampler_sources[0]))
+
 //battery data
 #ifndef NO_BATTERY_ICON
     uint32_t lowbat_icon_bar_color = 0xFF000000, lowbat_icon_bar_bg_color = 0xFF000000;
@@ -157,6 +515,12 @@ int32_t battery_rsoc = -1, battery_rsoc_last = -2; //current battery percentage
     bool gpio_enabled[gpio_pins_count] = {0}; //use gpio triggers, leave as is, defined during runtime
     int *gpio_pin[gpio_pins_count] = {&lowbat_gpio, &osd_gpio, &tinyosd_gpio}; //gpio pins, leave as is, defined during runtime
     bool *gpio_reversed[gpio_pins_count] = {&lowbat_gpio_reversed, &osd_gpio_reversed, &tinyosd_gpio_reversed}; //gpio signal reversed, leave as is, defined during runtime
+    int gpio_cdev_fd = -1; //gpio character device line request fd, all enabled pins, -1 if not used
+    int gpio_cdev_line[gpio_pins_count] = {-1, -1, -1}; //pin index in line request, shared if same pin used for multiple triggers
+    bool gpio_edge_events[gpio_pins_count] = {0}; //pin state updated from edge events (gpio character device or libgpiod), polled otherwise
+    bool gpio_active[gpio_pins_count] = {0}; //debounced pin state, reverse applied
+    bool gpio_pending[gpio_pins_count] = {0}; double gpio_pending_time[gpio_pins_count] = {-1., -1., -1.}; //last raw level (reverse applied), time of last edge not yet debounced, -1 if none
+    double gpio_press_time[gpio_pins_count] = {-1., -1., -1.}; //edge time of current press, trigger latency and hold reference
 #endif
 
 //bitmap buffers
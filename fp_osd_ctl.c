@@ -0,0 +1,96 @@
+/*
+FreeplayTech On-screen (heads-up) display overlay
+
+Control socket client, replaces pid.txt + kill signal scripts.
+Please refer to fp_osd_ctl.h for protocol details.
+
+Compile: gcc -o fp_osd_ctl fp_osd_ctl.c
+Usage: ./fp_osd_ctl [-socket PATH] osd|tinyosd|hide|timeout <1-20>|query
+*/
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "fp_osd_ctl.h"
+
+static uint64_t get_time_ns(void){ //CLOCK_MONOTONIC time in nanosec, same clock as reply submit time
+    struct timespec tp; clock_gettime(CLOCK_MONOTONIC, &tp);
+    return (uint64_t)tp.tv_sec * 1000000000ULL + tp.tv_nsec;
+}
+
+static int fp_osd_ctl_send(const char* path, uint8_t cmd, int32_t value, int timeout_ms, fp_osd_ctl_reply_t* reply){ //send one request and wait for its reply, return 0 on success, negative errno otherwise
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)){return -ENAMETOOLONG;}
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0), ret = 0;
+    if (fd < 0){return -errno;}
+    struct timeval timeout = {.tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    fp_osd_ctl_request_t request = {.version = fp_osd_ctl_version, .cmd = cmd, .value = value, .request_id = (uint64_t)getpid()};
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || send(fd, &request, sizeof(request), MSG_NOSIGNAL) != sizeof(request)){ret = -errno;
+    } else {
+        ssize_t len = recv(fd, reply, sizeof(fp_osd_ctl_reply_t), 0);
+        if (len < 0){ret = -errno;} else if (len != sizeof(fp_osd_ctl_reply_t) || reply->version != fp_osd_ctl_version || reply->request_id != request.request_id){ret = -EPROTO;}
+    }
+    close(fd);
+    return ret;
+}
+
+static void program_usage(void){ //display help
+    fprintf(stderr, "Usage: fp_osd_ctl [-socket PATH] [-wait MS] COMMAND\n"
+    "Commands:\n"
+    "\tosd : display full OSD, returns once displayed.\n"
+    "\ttinyosd : display tiny OSD, returns once displayed.\n"
+    "\thide : hide displayed OSD.\n"
+    "\ttimeout <1-20> : set OSD displayed timeout in sec.\n"
+    "\tquery : current OSD state.\n"
+    "Arguments:\n"
+    "\t-socket <PATH> (control socket path. Default:'%s').\n"
+    "\t-wait <MS> (reply timeout in millisec. Default:30000).\n"
+    , fp_osd_ctl_default_path);
+}
+
+int main(int argc, char *argv[]){
+    const char *path = fp_osd_ctl_default_path, *cmd_str = NULL;
+    int wait_ms = 30000; int32_t value = 0; //show commands can be put on hold up to other osd timeout
+    for (int i=1; i<argc; i++){
+        if (strcmp(argv[i], "-socket") == 0 && i+1 < argc){path = argv[++i];
+        } else if (strcmp(argv[i], "-wait") == 0 && i+1 < argc){wait_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-help") == 0){program_usage(); return EXIT_SUCCESS;
+        } else if (cmd_str == NULL){cmd_str = argv[i];
+        } else {value = atoi(argv[i]);}
+    }
+
+    uint8_t cmd = 0;
+    if (cmd_str == NULL){program_usage(); return EXIT_FAILURE;
+    } else if (strcmp(cmd_str, "osd") == 0){cmd = FP_OSD_CTL_SHOW_OSD;
+    } else if (strcmp(cmd_str, "tinyosd") == 0){cmd = FP_OSD_CTL_SHOW_TINYOSD;
+    } else if (strcmp(cmd_str, "hide") == 0){cmd = FP_OSD_CTL_HIDE;
+    } else if (strcmp(cmd_str, "timeout") == 0){cmd = FP_OSD_CTL_SET_TIMEOUT;
+    } else if (strcmp(cmd_str, "query") == 0){cmd = FP_OSD_CTL_QUERY;
+    } else {fprintf(stderr, "Unknown command '%s'.\n", cmd_str); program_usage(); return EXIT_FAILURE;}
+
+    fp_osd_ctl_reply_t reply = {0};
+    uint64_t start_time = get_time_ns();
+    int ret = fp_osd_ctl_send(path, cmd, value, wait_ms, &reply);
+    uint64_t end_time = get_time_ns();
+    if (ret < 0){fprintf(stderr, "Request failed: %s.\n", strerror(-ret)); return EXIT_FAILURE;}
+    if (reply.status < 0){fprintf(stderr, "Command failed: %s.\n", strerror(-reply.status)); return EXIT_FAILURE;}
+
+    if (cmd == FP_OSD_CTL_SHOW_OSD || cmd == FP_OSD_CTL_SHOW_TINYOSD){
+        double latency = (reply.submit_time_ns > start_time) ? (reply.submit_time_ns - start_time) / 1e6 : 0.;
+        printf("%s displayed, trigger to display: %.2lfms, round trip: %.2lfms\n", (cmd == FP_OSD_CTL_SHOW_OSD) ? "OSD" : "Tiny OSD", latency, (end_time - start_time) / 1e6);
+    } else {
+        printf("state:%s%s%s%s%s, timeout:%us\n", (reply.state & FP_OSD_CTL_STATE_OSD) ? " osd" : "", (reply.state & FP_OSD_CTL_STATE_TINYOSD) ? " tinyosd" : "", (reply.state & FP_OSD_CTL_STATE_OSD_HOLD) ? " osd_hold" : "", (reply.state & FP_OSD_CTL_STATE_TINYOSD_HOLD) ? " tinyosd_hold" : "", reply.state ? "" : " none", reply.timeout);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,44 @@
+/*
+FreeplayTech On-screen (heads-up) display overlay
+
+Control socket protocol, shared by fp_osd.c (server) and fp_osd_ctl.c (client).
+SOCK_SEQPACKET unix socket, one request datagram answered by one reply datagram.
+Show commands are answered once related OSD frame has been submitted, allowing caller to measure trigger to display latency.
+*/
+
+#include <stdint.h>
+
+#define fp_osd_ctl_default_path "/run/fp_osd.sock" //default control socket path, root owned folder
+#define fp_osd_ctl_version 1 //protocol version, requests with different version are rejected
+
+enum fp_osd_ctl_cmd_t {
+    FP_OSD_CTL_SHOW_OSD = 1, //display full osd, replied once displayed
+    FP_OSD_CTL_SHOW_TINYOSD, //display tiny osd, replied once displayed
+    FP_OSD_CTL_HIDE, //hide any displayed osd, cancel pending ones
+    FP_OSD_CTL_SET_TIMEOUT, //set osd displayed timeout, value in sec
+    FP_OSD_CTL_QUERY, //current state only
+};
+
+#define FP_OSD_CTL_STATE_OSD 0x1 //full osd displayed
+#define FP_OSD_CTL_STATE_TINYOSD 0x2 //tiny osd displayed
+#define FP_OSD_CTL_STATE_OSD_HOLD 0x4 //full osd waiting for tiny osd to close
+#define FP_OSD_CTL_STATE_TINYOSD_HOLD 0x8 //tiny osd waiting for full osd to close
+
+typedef struct fp_osd_ctl_request_s {
+    uint8_t version; //fp_osd_ctl_version
+    uint8_t cmd; //fp_osd_ctl_cmd_t
+    uint16_t reserved;
+    int32_t value; //command argument
+    uint64_t request_id; //echoed in reply
+} __attribute__((packed)) fp_osd_ctl_request_t;
+
+typedef struct fp_osd_ctl_reply_s {
+    uint8_t version; //fp_osd_ctl_version
+    uint8_t cmd; //request command
+    int16_t status; //0 on success, negative errno otherwise
+    uint8_t state; //FP_OSD_CTL_STATE_* bitmask
+    uint8_t reserved;
+    uint16_t timeout; //osd displayed timeout in sec
+    uint64_t request_id; //from request
+    uint64_t submit_time_ns; //CLOCK_MONOTONIC time the osd frame was submitted for show commands, reply time otherwise
+} __attribute__((packed)) fp_osd_ctl_reply_t;
@@ -0,0 +1,95 @@
+/*
+FreeplayTech On-screen (heads-up) display overlay
+
+Shared memory metrics writer, for scripts and test purpose.
+Please refer to fp_osd_shm.h for struct details, daemons should include it and write directly.
+
+Compile: gcc -o fp_osd_shm fp_osd_shm.c
+Usage: ./fp_osd_shm [-path PATH] [FIELD VALUE]... [custom <0-7> LABEL VALUE]... [clear] [dump]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fp_osd_shm.h"
+
+static void program_usage(void){ //display help
+    fprintf(stderr, "Usage: fp_osd_shm [-path PATH] COMMAND...\n"
+    "Commands:\n"
+    "\tbacklight <NUM> : backlight current value.\n"
+    "\tbacklight_max <NUM> : backlight maximum value.\n"
+    "\tbattery_rsoc <0-100> : battery percentage.\n"
+    "\tbattery_voltage <NUM> : battery voltage in microvolts.\n"
+    "\tgamepad <NUM> : gamepad status bitmask (1:connected, 2:error).\n"
+    "\tcustom <0-%d> <LABEL> <NUM> : custom value displayed by full OSD.\n"
+    "\tunset <FIELD> : invalidate field (backlight, backlight_max, battery_rsoc, battery_voltage, gamepad, custom0-%d).\n"
+    "\tclear : invalidate all fields.\n"
+    "\tdump : print valid fields.\n"
+    "Arguments:\n"
+    "\t-path <PATH> (shared memory file. Default:'%s').\n"
+    , fp_osd_shm_custom_count - 1, fp_osd_shm_custom_count - 1, fp_osd_shm_default_path);
+}
+
+static uint32_t field_valid_bit(const char* name){ //FP_OSD_SHM_VALID_* bit of field name, 0 if unknown
+    if (strcmp(name, "backlight") == 0){return FP_OSD_SHM_VALID_BACKLIGHT;}
+    if (strcmp(name, "backlight_max") == 0){return FP_OSD_SHM_VALID_BACKLIGHT_MAX;}
+    if (strcmp(name, "battery_rsoc") == 0){return FP_OSD_SHM_VALID_BATTERY_RSOC;}
+    if (strcmp(name, "battery_voltage") == 0){return FP_OSD_SHM_VALID_BATTERY_VOLTAGE;}
+    if (strcmp(name, "gamepad") == 0){return FP_OSD_SHM_VALID_GAMEPAD;}
+    if (strncmp(name, "custom", 6) == 0 && name[6] >= '0' && name[6] < '0' + fp_osd_shm_custom_count && name[7] == '\0'){return FP_OSD_SHM_VALID_CUSTOM(name[6] - '0');}
+    return 0;
+}
+
+static void shm_dump(fp_osd_shm_t* shm){ //print valid fields
+    fp_osd_shm_t data;
+    if (!fp_osd_shm_read(shm, &data)){fprintf(stderr, "Failed to read consistent data.\n"); return;}
+    printf("valid:0x%X, update time:%.3lfs\n", data.valid, data.update_time_ns / 1e9);
+    if (data.valid & FP_OSD_SHM_VALID_BACKLIGHT){printf("backlight:%d\n", data.backlight);}
+    if (data.valid & FP_OSD_SHM_VALID_BACKLIGHT_MAX){printf("backlight_max:%d\n", data.backlight_max);}
+    if (data.valid & FP_OSD_SHM_VALID_BATTERY_RSOC){printf("battery_rsoc:%d\n", data.battery_rsoc);}
+    if (data.valid & FP_OSD_SHM_VALID_BATTERY_VOLTAGE){printf("battery_voltage:%d\n", data.battery_voltage_uv);}
+    if (data.valid & FP_OSD_SHM_VALID_GAMEPAD){printf("gamepad:0x%X\n", data.gamepad_status);}
+    for (int i=0; i<fp_osd_shm_custom_count; i++){
+        if (data.valid & FP_OSD_SHM_VALID_CUSTOM(i)){printf("custom%d:'%s' %d\n", i, data.custom_label[i], data.custom[i]);}
+    }
+}
+
+int main(int argc, char *argv[]){
+    const char *path = fp_osd_shm_default_path;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-path") == 0){path = argv[2]; first = 3;}
+    if (first >= argc || strcmp(argv[first], "-h") == 0 || strcmp(argv[first], "-help") == 0){program_usage(); return (first >= argc) ? EXIT_FAILURE : EXIT_SUCCESS;}
+
+    fp_osd_shm_t *shm = fp_osd_shm_map(path, true);
+    if (shm == NULL){perror("Failed to map shared memory file"); return EXIT_FAILURE;}
+
+    bool dump = false;
+    fp_osd_shm_write_begin(shm);
+    for (int i=first; i<argc; i++){
+        const char *cmd = argv[i]; uint32_t bit = field_valid_bit(cmd);
+        if (strcmp(cmd, "dump") == 0){dump = true;
+        } else if (strcmp(cmd, "clear") == 0){shm->valid = 0;
+        } else if (strcmp(cmd, "unset") == 0 && i+1 < argc && (bit = field_valid_bit(argv[i+1])) != 0){shm->valid &= ~bit; i++;
+        } else if (strcmp(cmd, "custom") == 0 && i+3 < argc){
+            int index = atoi(argv[i+1]);
+            if (index < 0 || index >= fp_osd_shm_custom_count){fprintf(stderr, "Invalid custom index '%s'.\n", argv[i+1]); i += 3; continue;}
+            strncpy(shm->custom_label[index], argv[i+2], fp_osd_shm_label_size - 1); shm->custom_label[index][fp_osd_shm_label_size - 1] = '\0';
+            shm->custom[index] = atoi(argv[i+3]); shm->valid |= FP_OSD_SHM_VALID_CUSTOM(index); i += 3;
+        } else if (bit != 0 && bit < FP_OSD_SHM_VALID_CUSTOM(0) && i+1 < argc){
+            int32_t value = atoi(argv[++i]);
+            switch (bit){
+                case FP_OSD_SHM_VALID_BACKLIGHT: shm->backlight = value; break;
+                case FP_OSD_SHM_VALID_BACKLIGHT_MAX: shm->backlight_max = value; break;
+                case FP_OSD_SHM_VALID_BATTERY_RSOC: shm->battery_rsoc = value; break;
+                case FP_OSD_SHM_VALID_BATTERY_VOLTAGE: shm->battery_voltage_uv = value; break;
+                case FP_OSD_SHM_VALID_GAMEPAD: shm->gamepad_status = (uint32_t)value; break;
+            }
+            shm->valid |= bit;
+        } else {fprintf(stderr, "Invalid command '%s'.\n", cmd);}
+    }
+    fp_osd_shm_write_end(shm);
+
+    if (dump){shm_dump(shm);}
+    munmap(shm, sizeof(fp_osd_shm_t));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+/*
+FreeplayTech On-screen (heads-up) display overlay
+
+Shared memory metrics channel, shared by fp_osd.c (reader) and producer daemons (writers).
+Producers write raw integer metrics into a fp_osd_shm_t struct mmapped from a /dev/shm file, fp_osd reads it without any syscall.
+
+Rules for producers:
+- Open existing file without truncating it, never unlink or replace it while running (fp_osd keeps its mapping), fp_osd_shm_map() does so.
+- Wrap each update between fp_osd_shm_write_begin() and fp_osd_shm_write_end(), only one writer at a time.
+- Set FP_OSD_SHM_VALID_* bit of each written field, clear them on exit.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define fp_osd_shm_default_path "/dev/shm/fp_osd_metrics" //default shared memory file path
+#define fp_osd_shm_magic 0x4D534F46 //"FOSM"
+#define fp_osd_shm_version 1 //struct layout version, mapping with different version is ignored
+#define fp_osd_shm_custom_count 8 //custom fields count
+#define fp_osd_shm_label_size 16 //custom field label size, incl. null char
+
+#define FP_OSD_SHM_VALID_BACKLIGHT 0x1 //backlight
+#define FP_OSD_SHM_VALID_BACKLIGHT_MAX 0x2 //backlight_max
+#define FP_OSD_SHM_VALID_BATTERY_RSOC 0x4 //battery_rsoc
+#define FP_OSD_SHM_VALID_BATTERY_VOLTAGE 0x8 //battery_voltage_uv
+#define FP_OSD_SHM_VALID_GAMEPAD 0x10 //gamepad_status
+#define FP_OSD_SHM_VALID_CUSTOM(n) (0x100 << (n)) //custom[n] and custom_label[n]
+
+#define FP_OSD_SHM_GAMEPAD_CONNECTED 0x1 //gamepad detected by driver
+#define FP_OSD_SHM_GAMEPAD_ERROR 0x2 //driver failed to communicate with gamepad
+
+typedef struct fp_osd_shm_s {
+    uint32_t magic; //fp_osd_shm_magic
+    uint16_t version; //fp_osd_shm_version
+    uint16_t size; //sizeof(fp_osd_shm_t)
+    uint32_t seq; //seqlock sequence, odd while producer writes
+    uint32_t valid; //FP_OSD_SHM_VALID_* bitmask
+    uint64_t update_time_ns; //CLOCK_MONOTONIC time of last write
+    int32_t backlight, backlight_max; //backlight current and maximum value
+    int32_t battery_rsoc; //battery percentage
+    int32_t battery_voltage_uv; //battery voltage in microvolts
+    uint32_t gamepad_status; //FP_OSD_SHM_GAMEPAD_* bitmask
+    uint32_t reserved;
+    int32_t custom[fp_osd_shm_custom_count]; //custom values, displayed by full osd
+    char custom_label[fp_osd_shm_custom_count][fp_osd_shm_label_size]; //custom values label
+} fp_osd_shm_t;
+
+static inline fp_osd_shm_t* fp_osd_shm_map(const char* path, bool writable){ //map shared memory file, create and initialize it if writable, return NULL on failure
+    int fd = open(path, (writable ? (O_RDWR | O_CREAT) : O_RDONLY) | O_CLOEXEC, 0644);
+    if (fd < 0){return NULL;}
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || (file_stat.st_size < (off_t)sizeof(fp_osd_shm_t) && (!writable || ftruncate(fd, sizeof(fp_osd_shm_t)) != 0))){close(fd); return NULL;}
+    fp_osd_shm_t *shm = mmap(NULL, sizeof(fp_osd_shm_t), writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); //mapping stays valid
+    if (shm == MAP_FAILED){return NULL;}
+    if (writable && (shm->magic != fp_osd_shm_magic || shm->version != fp_osd_shm_version)){ //new file or older layout
+        memset(shm, 0, sizeof(fp_osd_shm_t));
+        shm->version = fp_osd_shm_version; shm->size = sizeof(fp_osd_shm_t);
+        __atomic_store_n(&shm->magic, fp_osd_shm_magic, __ATOMIC_RELEASE);
+    }
+    return shm;
+}
+
+static inline void fp_osd_shm_write_begin(fp_osd_shm_t* shm){ //producer: start update, seqlock write side
+    __atomic_store_n(&shm->seq, __atomic_load_n(&shm->seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED); //odd: write in progress
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void fp_osd_shm_write_end(fp_osd_shm_t* shm){ //producer: end update, set update time
+    struct timespec tp; clock_gettime(CLOCK_MONOTONIC, &tp);
+    shm->update_time_ns = (uint64_t)tp.tv_sec * 1000000000ULL + tp.tv_nsec;
+    __atomic_store_n(&shm->seq, shm->seq + 1, __ATOMIC_RELEASE); //even: consistent
+}
+
+static inline bool fp_osd_shm_read(const fp_osd_shm_t* shm, fp_osd_shm_t* dest){ //reader: consistent copy, return false if invalid header or producer kept writing
+    if (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != fp_osd_shm_magic || shm->version != fp_osd_shm_version || shm->size != sizeof(fp_osd_shm_t)){return false;}
+    for (int retry=0; retry<100; retry++){
+        uint32_t seq = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1){continue;} //write in progress
+        memcpy(dest, (const void*)shm, sizeof(fp_osd_shm_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (seq == __atomic_load_n(&shm->seq, __ATOMIC_RELAXED)){
+            for (int i=0; i<fp_osd_shm_custom_count; i++){dest->custom_label[i][fp_osd_shm_label_size-1] = '\0';}
+            return true;
+        }
+    }
+    return false; //producer died mid-write or writes continuously
+}
@@ -12,7 +12,8 @@ bool debug = false;
 //dispmanx
 int display_number = 0; //dispmanx display num
 int osd_layer = 10000; //dispmanx first layer
-int osd_check_rate = 30; //osd check rate in hz
+int osd_check_rate = 30; //osd refresh rate in hz while displayed
+bool dispmanx_async = true; //submit updates without waiting for videocore to commit them, at most one in flight, false to use synchronous updates
 #if !(defined(NO_OSD) && defined(NO_TINYOSD))
     int osd_timeout = 5; //osd displayed timeout in sec
 #endif
@@ -22,21 +23,36 @@ int osd_check_rate = 30; //osd check rate in hz
     char signal_path[PATH_MAX] = {'\0'}; //full path to signal file, invalid to disable
 #endif
 
+//control socket
+#ifndef NO_CONTROL_SOCKET
+    char ctl_socket_path[PATH_MAX] = fp_osd_ctl_default_path; //unix seqpacket control socket path, empty to disable
+    int ctl_socket_mode = 0660; //control socket permissions, owner and group only by default
+#endif
+
 //evdev
 #ifndef NO_EVDEV
-    int evdev_check_interval = 10; //recheck interval if event detection failed in seconds
-    char evdev_path[PATH_MAX] = "/dev/input/"; //event device path, will search for evdev_name if folder provided
-    char evdev_name_search[255] = "Controller Name"; //event device name to search
-
-    //input sequence to detect
-    int evdev_sequence_detect_interval_ms = 200; //max interval between first and last input detected in milliseconds
-    #define evdev_sequence_max 5 //maximum keys to detect at once for a osd version
+    int evdev_check_interval = 10; //rescan interval while no input device opened in seconds, only if input devices folder can't be watched
+    char evdev_path[PATH_MAX] = "/dev/input/"; //event device path, will search for evdev_name_search devices if folder provided
+    char evdev_name_search[255] = "Controller Name"; //event device name to search if no -evdev_device argument given, 'id:VVVV:PPPP' (hex) to match vendor and product, 'phys:PHYS' to match physical path
+    char evdev_sysfs_path[PATH_MAX] = "/sys/class/input"; //input class sysfs folder, devices matched without opening their node, empty to always open nodes
+    bool evdev_capability_filter = false; //also use devices reporting all keys of a trigger sequence, regardless of their name, opt-in: only devices matching by name are used by default
+
+    //input sequences to detect, keys separated by '+' character have to be held simultaneously, by ',' character pressed within detection interval, sequences separated by ';' character
+    int evdev_sequence_detect_interval_ms = 200; //max interval between first and last input detected in milliseconds, ',' separated sequences only
     #ifndef NO_OSD
-        char osd_evdev_sequence_char[1024] = "0x13c,0x136,0x137"; //each key separated by ',' charater, For reference: https://elixir.bootlin.com/linux/latest/source/include/uapi/linux/input-event-codes.h
+        char osd_evdev_sequence_char[1024] = "0x13c,0x136,0x137"; //For reference: https://elixir.bootlin.com/linux/latest/source/include/uapi/linux/input-event-codes.h
     #endif
     #ifndef NO_TINYOSD
-        char tinyosd_evdev_sequence_char[1024] = "0x13c,0x138,0x139"; //each key separated by ',' charater, For reference: https://elixir.bootlin.com/linux/latest/source/include/uapi/linux/input-event-codes.h
+        char tinyosd_evdev_sequence_char[1024] = "0x13c,0x138,0x139"; //For reference: https://elixir.bootlin.com/linux/latest/source/include/uapi/linux/input-event-codes.h
     #endif
+    char hide_evdev_sequence_char[1024] = "-1"; //hide any displayed osd, disabled by default
+#endif
+
+//gpio
+#ifndef NO_GPIO
+    char gpio_chip_path[PATH_MAX] = "/dev/gpiochip0"; //gpio character device used if no gpio library available
+    int gpio_debounce_ms = 10; //debounce period, kernel debounce for gpio character device, software otherwise, 0 to disable
+    int gpio_hold_ms = 500; //osd stays displayed while its trigger gpio is held longer than this, 0 to disable
 #endif
 
 //OSD
@@ -94,6 +110,26 @@ char battery_rsoc_path[PATH_MAX] = "/sys/class/power_supply/battery/capacity"; /
 char battery_volt_path[PATH_MAX] = "/sys/class/power_supply/battery/voltage_now"; //absolute path to battery voltage
 uint32_t battery_volt_divider = 1000000; //divide voltage by given value to get volt
 int lowbat_limit = 10; //low battery icon display threshold (percent)
+bool uevent_enabled = true; //listen to kernel power_supply uevents, battery capacity and voltage updated from event payload
+int uevent_safety_poll_ms = 60000; //battery capacity polling interval once power_supply uevents received, covers missed events
+char uevent_test_socket_path[PATH_MAX] = {'\0'}; //bind a unix datagram socket to this path instead of kernel netlink socket to inject uevents, for test purpose
+
+//data sources refresh interval in millisec, each source only sampled when its deadline expires
+int refresh_gpio_ms = 250; //gpio pins polling, only if edge events not available
+int refresh_battery_rsoc_ms = 1000; //battery percentage, low battery icon
+int refresh_cpu_thermal_ms = 1000; //cpu temperature, cpu temperature icon
+int refresh_battery_voltage_ms = 1000; //battery voltage (osd only)
+int refresh_cpu_load_ms = 500; //cpu load computed over this period (osd only)
+int refresh_backlight_ms = 500; //backlight (osd only)
+int refresh_network_ms = 5000; //network interfaces and wifi link (osd only)
+int refresh_time_sync_ms = 5000; //rtc module and ntp synchronization check (osd only)
+int refresh_memory_ms = 1000; //ram and swap (full osd only)
+int refresh_gpu_memory_ms = 5000; //gpu memory (full osd only)
+int refresh_throttled_ms = 1000; //undervoltage and throttling flags (full osd only)
+int refresh_shm_ms = 500; //gamepad status and custom values from shared memory metrics (full osd only)
+
+//shared memory metrics, written by producer daemons, please refer to fp_osd_shm.h
+char shm_metrics_path[PATH_MAX] = fp_osd_shm_default_path; //valid fields preferred over backlight and battery files, empty to disable
 
 //other paths
 #if !(defined(NO_OSD) && defined(NO_TINYOSD))
@@ -101,6 +137,9 @@ int lowbat_limit = 10; //low battery icon display threshold (percent)
     char backlight_path[PATH_MAX] = "/dev/shm/uhid_i2c_driver/0/backlight"; //absolute path to current backlight file
     char backlight_max_path[PATH_MAX] = "/dev/shm/uhid_i2c_driver/0/backlight_max"; //absolute path to max backlight file
 #endif
+#ifndef NO_OSD
+    char gencmd_stub_path[PATH_MAX] = {'\0'}; //answer videocore gencmd queries from this file instead of videocore, to display gencmd data off-Pi
+#endif
 
 //debug
 #ifdef CHARSET_EXPORT